@@ -0,0 +1,51 @@
+# - Try to find liburing
+# Once done this will define
+#
+#  LibUring_FOUND - system has liburing
+#  LibUring_INCLUDE_DIRS - the liburing include directory
+#  LibUring_LIBRARIES - Link these to use liburing
+#
+
+if (LibUring_LIBRARIES AND LibUring_INCLUDE_DIRS)
+  # in cache already
+  set(LibUring_FOUND TRUE)
+else (LibUring_LIBRARIES AND LibUring_INCLUDE_DIRS)
+
+  find_path(LibUring_INCLUDE_DIR
+    NAMES
+      liburing.h
+    HINTS
+      $ENV{LIBURING_ROOT}/include
+    PATHS
+      /usr/include
+      /usr/local/include
+  )
+
+  find_library(LibUring_LIBRARY
+    NAMES
+      uring
+    HINTS
+      $ENV{LIBURING_ROOT}/lib
+    PATHS
+      /usr/lib
+      /usr/local/lib
+  )
+
+  set(LibUring_INCLUDE_DIRS
+    ${LibUring_INCLUDE_DIR}
+  )
+
+  if (LibUring_LIBRARY)
+    set(LibUring_LIBRARIES
+        ${LibUring_LIBRARIES}
+        ${LibUring_LIBRARY}
+    )
+  endif (LibUring_LIBRARY)
+
+  include(FindPackageHandleStandardArgs)
+  find_package_handle_standard_args(LibUring DEFAULT_MSG LibUring_LIBRARIES LibUring_INCLUDE_DIRS)
+
+  # show the LibUring_INCLUDE_DIRS and LibUring_LIBRARIES variables only in the advanced view
+  mark_as_advanced(LibUring_INCLUDE_DIRS LibUring_LIBRARIES)
+
+endif (LibUring_LIBRARIES AND LibUring_INCLUDE_DIRS)
@@ -0,0 +1,113 @@
+// Compare the parsing of small requests: the former parser built on std::istringstream and boost::split,
+// then the framing and in place parsing of the server with each instruction set of http_scanner.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+
+#include "http_request_framer.h"
+#include "http_scanner.h"
+#include "http_service.h"
+
+namespace
+{
+
+constexpr size_t ITERATIONS = 200000;
+
+const std::string BROWSER_REQUEST =
+    "GET /api/v1/items?page=2&sort=name HTTP/1.1\r\n"
+    "Host: localhost:8081\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,*/*;q=0.8\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9,fr;q=0.8\r\n"
+    "Referer: http://localhost:8081/index.html\r\n"
+    "If-None-Match: \"5d8c72a5edda8d6a\"\r\n"
+    "If-Modified-Since: Sat, 29 Oct 1994 19:43:31 GMT\r\n"
+    "\r\n";
+
+const std::string API_REQUEST =
+    "POST /api/v1/items HTTP/1.1\r\n"
+    "Host: localhost:8081\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 16\r\n"
+    "\r\n"
+    "{\"name\":\"value\"}";
+
+// The parser of http_protocol_one_one before the requests were parsed in place.
+size_t legacy_parse(const std::string& request)
+{
+    std::istringstream input(request);
+    std::string request_line;
+    std::getline(input, request_line);
+
+    std::vector<std::string> request_line_split;
+    boost::split(request_line_split, request_line, boost::is_space());
+    if (request_line_split.size() > 0 && request_line_split.back().length() == 0)
+        request_line_split.pop_back();
+
+    http_request structured_request;
+    structured_request.request_uri = request_line_split.at(1);
+    structured_request.http_version = request_line_split.at(2);
+    for (std::string line; std::getline(input, line) && !line.empty();) {
+        const size_t colon_position = line.find_first_of(":");
+        if (colon_position == std::string::npos || line.length() < 2)
+            continue;
+        if (line.back() == '\r') line.pop_back();
+        structured_request.request_header.emplace(line.substr(0, colon_position), line.substr(colon_position + 2));
+    }
+    return structured_request.request_header.size();
+}
+
+size_t framed_parse(const std::string& request)
+{
+    http_request_framer framer;
+    if (framer.consume(request.data(), request.size()) != http_request_framer::status::complete)
+        return 0;
+    const auto buffer = std::make_shared<const std::string>(request);
+    return http_service::parse_request_view(buffer).header.size();
+}
+
+template <typename Parse>
+void measure(const std::string& name, const std::string& request, Parse parse)
+{
+    size_t headers = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i)
+        headers += parse(request);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / ITERATIONS;
+    std::cout << std::left << std::setw(24) << name << std::right << std::setw(10) << std::fixed << std::setprecision(1)
+              << ns << " ns/request (" << headers / ITERATIONS << " headers)" << std::endl;
+}
+
+}
+
+int main()
+{
+    const std::pair<const char*, http_scanner::isa> instruction_sets[] = {
+        {"scalar", http_scanner::isa::scalar},
+        {"sse4.2", http_scanner::isa::sse42},
+        {"avx2",   http_scanner::isa::avx2}
+    };
+
+    for (const auto& request : {std::make_pair("browser request", &BROWSER_REQUEST), std::make_pair("api request", &API_REQUEST)}) {
+        std::cout << request.first << " (" << request.second->size() << " bytes):" << std::endl;
+        measure("  legacy parser", *request.second, &legacy_parse);
+        for (const auto& instruction_set : instruction_sets) {
+            if (http_scanner::select(instruction_set.second))
+                measure(std::string("  framer + view, ") + instruction_set.first, *request.second, &framed_parse);
+        }
+        http_scanner::select(http_scanner::detect());
+    }
+    return 0;
+}
@@ -1,6 +1,7 @@
 #ifndef HTTP_CONSTANTS_H
 #define HTTP_CONSTANTS_H
 
+#include <cstddef>
 #include <cstdint>
 #include <ctime>
 #include <string>
@@ -18,6 +19,35 @@ struct http_constants
         m_connect = 7
     };
 
+    /// \brief HTTP-Version of a request, resolved once as its Request-Line is parsed.
+    enum class version : uint8_t {
+        unknown = 0,
+        http_1_0,
+        http_1_1
+    };
+
+    /// \brief Header known to the protocol, in the order of GENERAL_HEADER, REQUEST_HEADER and ENTITY_HEADER.
+    enum class header_id : uint8_t {
+        unknown = 0,
+
+        cache_control, connection, date, pragma, trailer, transfer_encoding, upgrade, via, warning,
+
+        accept, accept_charset, accept_encoding, accept_language, authorization, expect, from, host, if_match,
+        if_modified_since, if_none_match, if_range, if_unmodified_since, max_forwards, proxy_authorization, range,
+        referer, te, user_agent,
+
+        allow, content_encoding, content_language, content_length, content_location, content_md5, content_range,
+        content_type, expires, last_modified
+    };
+
+    /// \brief Class of a header, which of the header maps of http_request holds it.
+    enum class header_class : uint8_t {
+        general = 0,
+        request,
+        entity,
+        extension ///< A header unknown to the protocol (RFC2616 section 7.1).
+    };
+
     enum class status_class : uint8_t {
         informational = 1,
         success = 2,
@@ -89,6 +119,28 @@ struct http_constants
                                            "Content-Location", "Content-MD5", "Content-Range", "Content-Type",
                                            "Expires", "Last-Modified"};
 
+    /// \brief Identify a method from its token, see METHODS.
+    ///
+    /// \param token The method token of a Request-Line, matched with its case.
+    /// \param length The length of the token.
+    /// \param m Set to the method.
+    /// \returns False if the protocol does not define the method.
+    static bool find_method(const char* token, size_t length, method& m) noexcept;
+
+    /// \brief Identify an HTTP-Version from its token, e.g.: 'HTTP/1.1'.
+    /// \returns The version, version::unknown if no protocol handler implements it.
+    static version find_version(const char* token, size_t length) noexcept;
+
+    /// \brief Identify a header from its name, in constant time.
+    ///
+    /// \param name The name of the header, matched regardless of its case.
+    /// \param length The length of the name.
+    /// \returns The header, header_id::unknown if the protocol does not define it.
+    static header_id find_header(const char* name, size_t length) noexcept;
+
+    /// \brief Class of a header, header_class::extension for an unknown one.
+    static header_class get_header_class(header_id id) noexcept;
+
     static std::string reason_phrase(status code);
     static status_class get_status_class(status code);
 
@@ -0,0 +1,78 @@
+#ifndef HTTP_REQUEST_FRAMER_H
+#define HTTP_REQUEST_FRAMER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// \brief Resumable detection of the boundaries of an http request in a stream of bytes.
+///
+/// The framer is fed the receive buffer of a connection as it grows and reports whether it holds a complete
+/// request: the header up to the empty line, followed by a message-body of Content-Length bytes.
+/// The position reached in the header is kept between calls so the bytes already seen are never scanned again.
+class http_request_framer
+{
+public:
+    enum class status : uint8_t {
+        incomplete = 0, ///< More bytes are needed to complete the request.
+        complete,       ///< The request spans [request_begin(), request_end()) in the buffer.
+        invalid,        ///< The bytes cannot be framed as an http request.
+        too_large       ///< The header announces a message-body longer than allowed.
+    };
+
+    /// \brief Maximum size of a request header, anything longer is invalid.
+    static constexpr size_t MAX_HEADER_LENGTH = 64 * 1024;
+
+    /// \brief Constructor of the framer.
+    ///
+    /// \param max_content_length Length of the message-body allowed, 0 for no limit other than the
+    ///                           length of the buffer.
+    explicit http_request_framer(size_t max_content_length = 0) noexcept;
+
+    /// \brief Resume the framing of the request at the front of a buffer.
+    /// \note The buffer must start with the same bytes on every call, only growing at the end.
+    ///
+    /// \param buffer The received bytes, starting with the request being framed.
+    /// \param length The number of bytes in the buffer.
+    /// \returns The status of the request.
+    status consume(const char* buffer, size_t length) noexcept;
+
+    /// \brief Offset of the request in the buffer, after the empty lines preceding it (RFC2616 section 4.1).
+    size_t request_begin() const noexcept { return begin_; }
+
+    /// \brief Offset following the last byte of the request, valid once complete.
+    size_t request_end() const noexcept { return header_end_ + content_length_; }
+
+    /// \brief Check if the empty line closing the header was found, the framer then waits for the message-body.
+    bool header_complete() const noexcept { return stage_ == stage::body; }
+
+    /// \brief Offset following the empty line closing the header, valid once the header is complete.
+    size_t header_end() const noexcept { return header_end_; }
+
+    /// \brief Length of the message-body announced by the header.
+    size_t content_length() const noexcept { return content_length_; }
+
+    /// \brief Prepare the framer for the next request of the connection, with the same limits.
+    void reset() noexcept;
+
+private:
+    enum class stage : uint8_t {
+        header,
+        body,
+        invalid,
+        too_large
+    };
+
+    bool parse_header_line(const char* line, size_t length) noexcept;
+
+    const size_t max_content_length_;
+
+    stage  stage_;
+    size_t begin_;
+    size_t scanned_;
+    size_t line_begin_;
+    size_t header_end_;
+    size_t content_length_;
+    bool   has_content_length_;
+};
+
+#endif
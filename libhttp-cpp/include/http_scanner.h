@@ -0,0 +1,53 @@
+#ifndef HTTP_SCANNER_H
+#define HTTP_SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// \brief Vectorized search of the delimiters of an http request: line feeds, spaces and colons.
+///
+/// The bytes are compared to a set of delimiters 32 at a time with AVX2, or 16 at a time with SSE4.2, the
+/// best instruction set supported by the processor being detected once at startup. Other processors, and
+/// the last bytes of a range, are scanned one byte at a time. A single delimiter is searched with memchr,
+/// which the C library already vectorizes.
+class http_scanner
+{
+public:
+    enum class isa : uint8_t {
+        scalar = 0,
+        sse42,
+        avx2
+    };
+
+    /// \brief Maximum number of delimiters searched at once.
+    static constexpr size_t MAX_DELIMITERS = 16;
+
+    /// \brief Find the first byte of a range equal to one of a set of delimiters.
+    ///
+    /// \param begin The first byte of the range.
+    /// \param end The byte following the range.
+    /// \param delimiters The delimiters searched.
+    /// \param count The number of delimiters, at most MAX_DELIMITERS.
+    /// \returns The first delimiter found, end if the range has none.
+    static const char* find_first_of(const char* begin, const char* end, const char* delimiters, size_t count) noexcept;
+
+    /// \brief Find the first byte of a range equal to a delimiter.
+    static const char* find(const char* begin, const char* end, char delimiter) noexcept
+    {
+        return find_first_of(begin, end, &delimiter, 1);
+    }
+
+    /// \brief Best instruction set supported by the processor.
+    static isa detect() noexcept;
+
+    /// \brief Instruction set used by the searches.
+    static isa selected() noexcept;
+
+    /// \brief Use another instruction set, supported by the processor, for the searches.
+    /// \note Meant for the tests and benchmarks, before the searches run on other threads.
+    ///
+    /// \returns False if the processor does not support the instruction set.
+    static bool select(isa instruction_set) noexcept;
+};
+
+#endif
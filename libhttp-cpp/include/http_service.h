@@ -48,6 +48,12 @@ public:
     /// \returns The structured http request.
     static http_request parse_request(const std::string& request);
 
+    /// \brief Parse an http request in place, without copying its fields.
+    ///
+    /// \param request The http request, kept alive by the structured request.
+    /// \returns The structured http request, whose fields are slices of the request.
+    static http_request_view parse_request_view(std::shared_ptr<const std::string> request);
+
     /// \brief Parse an http response from a string.
     ///
     /// \param request The http response.
@@ -63,14 +69,20 @@ public:
     /// \brief Execute a structured http request and returns a structured response.
     ///
     /// \param request The http request.
+    /// \param allow_file_body Let the resources leave the message body in a file (see http_response::file_body),
+    ///                        for a caller able to send it without reading it in memory.
     /// \returns The http response given as an object.
-    http_response execute(const http_request& request) const;
+    http_response execute(const http_request& request, bool allow_file_body = false) const;
+
+    /// \brief Execute a request parsed in place, see execute(const http_request&, bool).
+    http_response execute(const http_request_view& request, bool allow_file_body = false) const;
 
     /// \brief Return the host name of an http request.
     ///
     /// \param request The http request.
     /// \returns The hostname found in the request.
     static host extract_host(const http_request&);
+    static host extract_host(const http_request_view&);
 
     const std::string name_;
     const host        host_;
@@ -80,6 +92,9 @@ protected:
     http_service(const http_service&) = delete;
     http_service& operator=(const http_service&) = delete;
 
+    /// \brief Execute a generic request with the handler of its protocol version.
+    http_response execute(generic_request& grequest, http_constants::version http_version) const;
+
     const std::string service_path_;
 
     std::unique_ptr<http_resource_factory> resource_factory_;
@@ -3,10 +3,15 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <iterator>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
 
 #include "http_constants.h"
 #include "interface/generic_structure.h"
@@ -49,9 +54,102 @@ struct http_request
     header_map  general_header;
     header_map  request_header;
     header_map  entity_header;
+    header_map  extension_header; ///< The headers unknown to the protocol.
     std::string message_body;
 
+    /// \brief Message body left in a file by the server in place of message_body, when it is too large to
+    ///        be held in memory.
+    generic_file_body file_body;
+
     generic_request to_generic() const;
+
+    /// \brief Check if the client asks for a persistent connection.
+    /// HTTP/1.1 connections persist unless the client sends 'Connection: close', HTTP/1.0 connections
+    /// only persist with 'Connection: keep-alive' (RFC2616 section 8.1).
+    bool keep_alive() const;
+};
+
+/// \brief Components of a Request-URI, each a slice of it (RFC2616 section 5.1.2).
+///
+///   Request-URI  = "*" | absoluteURI | abs_path | authority
+///   absoluteURI  = "http:" "//" host [ ":" port ] [ abs_path [ "?" query ]]
+struct http_request_uri
+{
+    using string_view = boost::string_view;
+
+    enum class form : uint8_t {
+        invalid = 0,
+        asterisk,     ///< The request applies to the server itself.
+        absolute_uri, ///< The host of the URI takes precedence over the Host header.
+        abs_path,     ///< The host is given by the Host header.
+        authority     ///< Only a host and a port, as sent with CONNECT.
+    };
+
+    form        type = form::invalid;
+    string_view host;     ///< Host of an absoluteURI or an authority, empty otherwise.
+    string_view port;     ///< Digits of the port following the host, empty when absent.
+    string_view abs_path; ///< Path of an absoluteURI or an abs_path, possibly empty for an absoluteURI.
+    string_view query;    ///< Query following the path, without its '?'.
+
+    /// \brief Split a Request-URI in its components, without allocating.
+    static http_request_uri parse(string_view request_uri) noexcept;
+
+    /// \brief Split an authority, such as the value of the Host header: host [ ":" port ].
+    /// \returns False if the authority is invalid.
+    static bool parse_authority(string_view authority, string_view& host, string_view& port) noexcept;
+
+    /// \brief Read the digits of a port.
+    ///
+    /// \param digits The digits, empty for the default port 80.
+    /// \param port Set to the port number.
+    /// \returns False if the digits are not a port number.
+    static bool parse_port(string_view digits, uint16_t& port) noexcept;
+};
+
+/// \brief Request parsed in place, each of its fields is a slice of the request it was parsed from.
+///
+/// The view keeps the request alive, parsing it only allocates the list of its headers. The owning
+/// http_request is only built on demand, with to_request.
+struct http_request_view
+{
+    using string_view = boost::string_view;
+
+    struct header_field
+    {
+        string_view name;
+        string_view value;
+        http_constants::header_id id; ///< Identified as it is parsed, header_id::unknown for an extension header.
+    };
+
+    using header_list = std::vector<header_field>;
+
+    std::shared_ptr<const std::string> buffer; ///< The request every field is a slice of.
+
+    http_constants::method method;
+    string_view request_uri;
+    http_request_uri uri;     ///< The components of request_uri.
+    string_view http_version;
+    http_constants::version version = http_constants::version::unknown; ///< http_version, resolved as it is parsed.
+    header_list header;       ///< The headers in the order of the request, general, request and entity ones.
+    string_view message_body;
+
+    /// \brief Message body left in a file by the server in place of message_body, see http_request::file_body.
+    generic_file_body file_body;
+
+    /// \brief Find a header of the request.
+    ///
+    /// \param name The name of the header, matched regardless of its case.
+    /// \returns The first header with the name, nullptr if the request has none.
+    const header_field* find_header(string_view name) const noexcept;
+
+    /// \brief Find a header known to the protocol, without comparing its name.
+    const header_field* find_header(http_constants::header_id id) const noexcept;
+
+    /// \brief Check if the client asks for a persistent connection, see http_request::keep_alive.
+    bool keep_alive() const noexcept;
+
+    /// \brief Build a copy of the request owning its fields.
+    http_request to_request() const;
 };
 
 struct http_response
@@ -82,6 +180,12 @@ struct http_response
     header_map  entity_header;
     std::string message_body;
 
+    /// \brief Message body left in a file, written by the server after the serialized response.
+    generic_file_body file_body;
+
+    /// \brief Producer of the rest of the message body, streamed by the server after message_body.
+    std::function<bool(std::string& chunk)> body_producer;
+
     http_response(const std::string http_version = DEFAULT_HTTP_VERSION) noexcept : http_version(http_version) {}
     http_response(const generic_response& gresponse, const std::string http_version = DEFAULT_HTTP_VERSION) noexcept;
 };
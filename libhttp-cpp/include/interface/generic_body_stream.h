@@ -0,0 +1,77 @@
+#ifndef GENERIC_BODY_STREAM_H
+#define GENERIC_BODY_STREAM_H
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <istream>
+#include <streambuf>
+
+#include <unistd.h>
+
+#include "generic_structure.h"
+
+/// \brief Input stream over the message body of a request, held in memory or left in a file by the server.
+///
+/// A large upload is read in pieces of a fixed size, the resource never holds the whole message body.
+class generic_body_stream : public std::istream
+{
+public:
+    explicit generic_body_stream(const generic_request& request) : std::istream(nullptr), buffer_(request)
+    {
+        rdbuf(&buffer_);
+    }
+
+    /// \brief Length of the message body.
+    uint64_t length() const noexcept { return buffer_.length(); }
+
+private:
+    class body_buffer : public std::streambuf
+    {
+    public:
+        explicit body_buffer(const generic_request& request) : file_(request.file_body), position_(0)
+        {
+            if (!file_) {
+                char* begin = const_cast<char*>(request.message_body.data());
+                setg(begin, begin, begin + request.message_body.size());
+            }
+        }
+
+        uint64_t length() const noexcept
+        {
+            return file_ ? file_.length : static_cast<uint64_t>(egptr() - eback());
+        }
+
+    protected:
+        int_type underflow() override
+        {
+            if (gptr() < egptr())
+                return traits_type::to_int_type(*gptr());
+            if (!file_ || position_ >= file_.length)
+                return traits_type::eof();
+
+            // The file is shared, every read gives its own offset.
+            const size_t wanted = static_cast<size_t>(std::min<uint64_t>(chunk_.size(), file_.length - position_));
+            ssize_t received;
+            do {
+                received = ::pread(*file_.descriptor, chunk_.data(), wanted, static_cast<off_t>(file_.offset + position_));
+            } while (received < 0 && errno == EINTR);
+            if (received <= 0)
+                return traits_type::eof();
+
+            position_ += static_cast<uint64_t>(received);
+            setg(chunk_.data(), chunk_.data(), chunk_.data() + received);
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        const generic_file_body file_;
+        uint64_t position_;
+        std::array<char, 64 * 1024> chunk_;
+    };
+
+    body_buffer buffer_;
+};
+
+#endif
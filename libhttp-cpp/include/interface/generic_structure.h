@@ -1,21 +1,49 @@
 #ifndef GENERIC_STRUCTURE_H
 #define GENERIC_STRUCTURE_H
 
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 
+#include <boost/utility/string_view.hpp>
+
 #include "http_constants.h"
 
+/// \brief Message body left in an open file, written or read by the server straight from the page cache.
+struct generic_file_body {
+    generic_file_body() : offset(0), length(0) {};
+
+    std::shared_ptr<const int> descriptor; ///< The open file, closed with the last copy of the body.
+    uint64_t                   offset;
+    uint64_t                   length;
+
+    explicit operator bool() const { return static_cast<bool>(descriptor); }
+};
+
 struct generic_request {
     using header_map = std::map<std::string, std::string>;
 
     generic_request(http_constants::method m, const std::string& request_uri, const std::string& message_body) :
-        method(m), request_uri(request_uri), message_body(message_body) {};
+        method(m), request_uri(request_uri), abs_path(request_uri), message_body(message_body), file_body_allowed(false) {};
 
     http_constants::method method;
     const std::string&     request_uri;
+
+    /// \brief Path and query of the Request-URI, slices of request_uri without the host of an absoluteURI.
+    boost::string_view     abs_path;
+    boost::string_view     query;
+
     header_map             header;
     const std::string&     message_body;
+
+    /// \brief Message body left in a file by the server in place of message_body, when it is too large to be
+    ///        held in memory. Read either of them through generic_body_stream.
+    generic_file_body      file_body;
+
+    /// \brief The server can send a message body left in a file, see generic_response::file_body.
+    bool                   file_body_allowed;
 };
 
 struct generic_response {
@@ -26,7 +54,18 @@ struct generic_response {
     http_constants::status status_code;
     header_map             header;
     std::string            message_body;
+
+    /// \brief False when message_body only holds the beginning of the message body, the rest being streamed
+    ///        from body_producer.
     bool                   message_body_complete;
+
+    /// \brief Produces the rest of the message body when it is not complete: called with an empty chunk to
+    ///        fill until it returns false, once the body is complete. The server sends every chunk as soon as
+    ///        it is produced, and only asks for the next ones while the client keeps up.
+    std::function<bool(std::string& chunk)> body_producer;
+
+    /// \brief Message body to send from a file instead of message_body, only when the request allows it.
+    generic_file_body      file_body;
 };
 
 #endif
@@ -4,6 +4,7 @@
 
 ///////////////////////////////////////////////////////////
 // Other includes
+#include <cstring>
 #include <exception>
 #include <stdexcept>
 
@@ -17,6 +18,145 @@ constexpr decltype(http_constants::GENERAL_HEADER) http_constants::GENERAL_HEADE
 constexpr decltype(http_constants::REQUEST_HEADER) http_constants::REQUEST_HEADER;
 constexpr decltype(http_constants::ENTITY_HEADER) http_constants::ENTITY_HEADER;
 
+namespace
+{
+
+using header_id = http_constants::header_id;
+
+constexpr size_t GENERAL_HEADERS = http_constants::GENERAL_HEADER.size();
+constexpr size_t REQUEST_HEADERS = http_constants::REQUEST_HEADER.size();
+constexpr size_t KNOWN_HEADERS = GENERAL_HEADERS + REQUEST_HEADERS + http_constants::ENTITY_HEADER.size();
+static_assert(static_cast<size_t>(header_id::last_modified) == KNOWN_HEADERS,
+              "Every header of http_constants needs an identifier, in the same order.");
+
+// The table of the known headers has a slot per value of a byte, leaving most of them empty so a seed
+// hashing every header to its own slot is found after a few attempts.
+constexpr size_t HEADER_SLOT_BITS = 8;
+constexpr size_t HEADER_SLOTS = size_t(1) << HEADER_SLOT_BITS;
+static_assert(KNOWN_HEADERS < HEADER_SLOTS / 4, "Too many headers for the table of the known headers.");
+
+constexpr char to_lower(char c) noexcept
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr size_t length_of(const char* name) noexcept
+{
+    size_t length = 0;
+    while (name[length] != '\0')
+        ++length;
+    return length;
+}
+
+// Name of a known header, by its identifier minus one.
+constexpr const char* known_header(size_t index) noexcept
+{
+    return (index < GENERAL_HEADERS) ? http_constants::GENERAL_HEADER.begin()[index] :
+           (index < GENERAL_HEADERS + REQUEST_HEADERS) ? http_constants::REQUEST_HEADER.begin()[index - GENERAL_HEADERS] :
+           http_constants::ENTITY_HEADER.begin()[index - GENERAL_HEADERS - REQUEST_HEADERS];
+}
+
+// FNV-1a of the lowercase name, starting from the seed, folded to a slot of the table.
+constexpr size_t header_slot(uint32_t seed, const char* name, size_t length) noexcept
+{
+    uint32_t hash = seed;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ static_cast<uint8_t>(to_lower(name[i]))) * 16777619u;
+    return hash >> (32 - HEADER_SLOT_BITS);
+}
+
+struct header_table
+{
+    bool     perfect;
+    uint32_t seed;
+    uint8_t  slots[HEADER_SLOTS]; ///< The identifier of the header hashed to the slot, 0 if none is.
+};
+
+// Search the first seed hashing every known header to its own slot.
+constexpr header_table make_header_table() noexcept
+{
+    constexpr uint32_t FNV_OFFSET_BASIS = 2166136261u;
+    for (uint32_t seed = FNV_OFFSET_BASIS; seed != FNV_OFFSET_BASIS + 10000; ++seed) {
+        header_table table{true, seed, {}};
+        for (size_t i = 0; i < KNOWN_HEADERS && table.perfect; ++i) {
+            const char* name = known_header(i);
+            uint8_t& slot = table.slots[header_slot(seed, name, length_of(name))];
+            table.perfect = (slot == 0);
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        if (table.perfect)
+            return table;
+    }
+    return header_table{false, 0, {}};
+}
+
+constexpr header_table HEADER_TABLE = make_header_table();
+static_assert(HEADER_TABLE.perfect, "No perfect hash of the known headers was found, change HEADER_SLOT_BITS.");
+
+}
+
+bool http_constants::find_method(const char* token, size_t length, method& m) noexcept
+{
+    // Methods are case-sensitive, the length and the first character leave a single candidate.
+    size_t index;
+    switch (length) {
+        case 3:  index = (token[0] == 'G') ? 1 : 4; break;
+        case 4:  index = (token[0] == 'H') ? 2 : 3; break;
+        case 5:  index = 6; break;
+        case 6:  index = 5; break;
+        case 7:  index = (token[0] == 'O') ? 0 : 7; break;
+        default: return false;
+    }
+
+    const char* known = *(METHODS.begin() + index);
+    if (std::memcmp(known, token, length) != 0)
+        return false;
+    m = static_cast<method>(index);
+    return true;
+}
+
+http_constants::version http_constants::find_version(const char* token, size_t length) noexcept
+{
+    // HTTP-Version = "HTTP" "/" 1*DIGIT "." 1*DIGIT, only the versions with a protocol handler are told apart.
+    constexpr char PREFIX[] = "HTTP/1.";
+    constexpr size_t PREFIX_LENGTH = sizeof(PREFIX) - 1;
+    if (length != PREFIX_LENGTH + 1 || std::memcmp(token, PREFIX, PREFIX_LENGTH) != 0)
+        return version::unknown;
+
+    switch (token[PREFIX_LENGTH]) {
+        case '0': return version::http_1_0;
+        case '1': return version::http_1_1;
+        default:  return version::unknown;
+    }
+}
+
+http_constants::header_id http_constants::find_header(const char* name, size_t length) noexcept
+{
+    const uint8_t slot = HEADER_TABLE.slots[header_slot(HEADER_TABLE.seed, name, length)];
+    if (slot == 0)
+        return header_id::unknown;
+
+    // Another name may hash to the slot of a known header.
+    const char* known = known_header(slot - 1);
+    for (size_t i = 0; i < length; ++i) {
+        if (known[i] == '\0' || to_lower(known[i]) != to_lower(name[i]))
+            return header_id::unknown;
+    }
+    return (known[length] == '\0') ? static_cast<header_id>(slot) : header_id::unknown;
+}
+
+http_constants::header_class http_constants::get_header_class(header_id id) noexcept
+{
+    const size_t index = static_cast<size_t>(id);
+    if (index == 0)
+        return header_class::extension;
+    if (index <= GENERAL_HEADERS)
+        return header_class::general;
+    if (index <= GENERAL_HEADERS + REQUEST_HEADERS)
+        return header_class::request;
+    return header_class::entity;
+}
+
 std::string http_constants::reason_phrase(http_constants::status code)
 {
 	switch (code) {
@@ -2,12 +2,17 @@
 
 #include <exception>
 #include <ios>
-#include <limits>
 
 #include "http_constants.h"
 
 #include <boost/filesystem.hpp>
 
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
 #include "logger.h"
 
 http_filesystem_resource::http_filesystem_resource(const std::string& request_uri, magic_handle_t magic_handle) :
@@ -18,13 +23,25 @@ http_filesystem_resource::http_filesystem_resource(const std::string& request_ur
 
 void http_filesystem_resource::execute(const generic_request& request, generic_response& response)
 {
+    // The files are only read, the other methods are refused along with the ones allowed (RFC2616 section 10.4.6).
+    if (request.method != http_constants::method::m_get && request.method != http_constants::method::m_head) {
+        response.header["Allow"] = "GET, HEAD";
+        response.status_code = http_constants::status::http_method_not_allowed;
+        return;
+    }
+
     const auto header = fetch_resource_header();
     response.header.insert(header.cbegin(), header.cend());
 
     if (request.method == http_constants::method::m_get) {
-        std::ostringstream resource_stream;
-        fetch_resource_content(resource_stream);
-        response.message_body = resource_stream.str();
+        if (request.file_body_allowed && fetch_resource_file(response.file_body)) {
+            // The length announced must match the bytes the server will send from the file.
+            response.header["Content-Length"] = std::to_string(response.file_body.length);
+        } else {
+            std::ostringstream resource_stream;
+            fetch_resource_content(resource_stream);
+            response.message_body = resource_stream.str();
+        }
     }
 
     response.status_code = http_constants::status::http_ok;
@@ -34,14 +51,9 @@ http_filesystem_resource::header_t http_filesystem_resource::fetch_resource_head
 {
     header_t header;
 
-    // tellg might not return an offset in bytes...
-    // We use a more reliable method which reads/ignore everything.
-    stream_.ignore(std::numeric_limits<std::streamsize>::max());
-    std::streamsize length = stream_.gcount();
-    stream_.clear(); // Reset the eof flag set by ignore.
-    stream_.seekg(0, std::ios_base::beg);
-    assert(length >= 0);
-    header["Content-Length"] = std::to_string(static_cast<size_t>(length));
+    // tellg might not return an offset in bytes, and reading the whole file to count them costs as much
+    // as sending it: ask the filesystem instead.
+    header["Content-Length"] = std::to_string(boost::filesystem::file_size(request_uri_));
 
     header["Content-Type"] = get_content_type();
     header["Last-Modified"] = http_constants::http_date(boost::filesystem::last_write_time(request_uri_));
@@ -60,6 +72,31 @@ void http_filesystem_resource::fetch_resource_content(std::ostream& stream)
               std::ostreambuf_iterator<std::ostream::char_type>(stream));
 }
 
+bool http_filesystem_resource::fetch_resource_file(generic_file_body& body)
+{
+#if defined(_WIN32)
+    return false;
+#else
+    const int fd = ::open(request_uri_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat status;
+    if (::fstat(fd, &status) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    body.descriptor = std::shared_ptr<const int>(new int(fd), [](const int* descriptor) {
+        ::close(*descriptor);
+        delete descriptor;
+    });
+    body.offset = 0;
+    body.length = static_cast<uint64_t>(status.st_size);
+    return true;
+#endif
+}
+
 std::string http_filesystem_resource::get_content_type()
 {
     std::string content_type = "text/plain";
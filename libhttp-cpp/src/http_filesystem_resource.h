@@ -38,6 +38,12 @@ public:
     /// \param stream The stream to output the content to.
     virtual void fetch_resource_content(std::ostream& stream);
 
+    /// \brief Open the resource for the server to send it without reading it in memory.
+    ///
+    /// \param body The file body to fill in.
+    /// \returns False if the resource cannot be sent from a file, its content must be fetched instead.
+    virtual bool fetch_resource_file(generic_file_body& body);
+
 protected:
     std::string get_content_type();
 
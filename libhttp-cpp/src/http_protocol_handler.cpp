@@ -1,50 +1,73 @@
-#include "http_protocol_handler.hpp"
+#include "http_protocol_handler.h"
 
 #include "http_resource_factory.h"
 
-#include  <string>
-#include  <sstream>
+#include <string>
 
-// Include all supported http protocol version
-#include "http_protocol_one_one.h"
-#include "http_protocol_one_zero.h"
+#include "http_scanner.h"
 
 #include "logger.h"
 
+namespace
+{
+
+// Delimiters of the fields of the Request-Line, the line is scanned once for the first of them.
+constexpr char REQUEST_LINE_DELIMITERS[] = {http_constants::SP, '\n'};
+
+}
+
 http_protocol_handler::http_protocol_handler() noexcept
 {
 
 }
 
-std::string http_protocol_handler::extract_http_version(const std::string& request) noexcept
+boost::string_view http_protocol_handler::slice(const char* begin, const char* end) noexcept
+{
+    if (end > begin && *(end - 1) == '\r')
+        --end;
+    return boost::string_view(begin, static_cast<size_t>(end - begin));
+}
+
+http_request::parsing_status http_protocol_handler::parse_request_line(std::shared_ptr<const std::string> request, http_request_view& structured_request,
+                                                                       boost::string_view& rest) noexcept
 {
-    // Format of HTTP-Version: "HTTP" "/" 1*DIGIT "." 1*DIGIT
+    if (!request || request->empty())
+        return http_request::parsing_status::empty_request;
 
-    std::string line;
-    std::istringstream input(request);
-    std::getline(input, line);
+    structured_request.buffer = std::move(request);
+    const char* position = structured_request.buffer->data();
+    const char* end = position + structured_request.buffer->size();
 
-    if (line.empty()) return "";
-    if (line.back() == '\r') line.pop_back();
+    // Request-Line = Method SP Request-URI SP HTTP-Version CRLF
+    const char* method_end = http_scanner::find_first_of(position, end, REQUEST_LINE_DELIMITERS, 2);
+    const char* uri_end = (method_end != end && *method_end == http_constants::SP)
+                          ? http_scanner::find_first_of(method_end + 1, end, REQUEST_LINE_DELIMITERS, 2) : end;
+    if (uri_end == end || *uri_end != http_constants::SP)
+        return http_request::parsing_status::invalid_request_line;
 
-    const auto first_space_it = std::find(line.cbegin(), line.cend(), ' ');
-    const auto second_space_it = std::find(first_space_it + 1, line.cend(), ' ');
-    if (second_space_it != line.cend()) {
-        std::string http_version(second_space_it + 1, line.cend());
+    const char* line_end = http_scanner::find(uri_end + 1, end, '\n');
+    const boost::string_view raw_request_uri = slice(method_end + 1, uri_end);
+    const boost::string_view raw_http_version = slice(uri_end + 1, line_end);
+    if (raw_request_uri.empty() || raw_http_version.empty() ||
+        raw_http_version.find(http_constants::SP) != boost::string_view::npos)
+        return http_request::parsing_status::invalid_request_line;
 
-        return http_version;
-    }
-    return "";
-}
+    if (!http_constants::find_method(position, static_cast<size_t>(method_end - position), structured_request.method))
+        return http_request::parsing_status::invalid_request_line;
 
-http_protocol_handler* http_protocol_handler::get_handler(http_protocol_handler_cache& cache, const std::string& http_version) noexcept
-{
-    if (http_version == http_protocol_one_one::http_version)
-        return make_handle_impl<http_protocol_one_one>(cache);
-    if (http_version == http_protocol_one_zero::http_version)
-        return make_handle_impl<http_protocol_one_zero>(cache);
+    structured_request.request_uri = raw_request_uri;
+    structured_request.uri = http_request_uri::parse(raw_request_uri);
+    structured_request.http_version = raw_http_version;
+    structured_request.version = http_constants::find_version(raw_http_version.data(), raw_http_version.size());
+    if (structured_request.version == http_constants::version::unknown)
+        logger::log()->warn() << "Unknown http version: '" << raw_http_version << "'.";
 
-    logger::log()->warn() << "Unknown http version: '" << http_version << "'.";
+    position = (line_end != end) ? line_end + 1 : end;
+    rest = boost::string_view(position, static_cast<size_t>(end - position));
+    return http_request::parsing_status::success;
+}
 
-    return nullptr;
+http_protocol_handler* http_protocol_handler::get_handler(const http_protocol_handler_cache& cache, http_constants::version http_version) noexcept
+{
+    return cache.get(http_version);
 }
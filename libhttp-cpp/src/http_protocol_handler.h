@@ -3,7 +3,8 @@
 
 #include <memory>
 #include <string>
-#include <unordered_map>
+
+#include <boost/utility/string_view.hpp>
 
 #include "http_protocol_handler_cache.h"
 #include "http_structure.h"
@@ -19,37 +20,40 @@ public:
     virtual ~http_protocol_handler() = default;
 
 
-    /// \brief Get the protocol version from the entire http request.
+    /// \brief Parse the Request-Line of an http request, common to every protocol version.
+    /// The line is scanned once for its method, its Request-URI and its HTTP-Version, which selects the
+    /// protocol handler parsing the rest of the request.
     ///
-    /// \param request The entire http request in string.
-    /// \returns The http version extracted from the requets or empty if the version could not be found.
-    static std::string extract_http_version(const std::string& request) noexcept;
+    /// \param request The entire http request in string, kept alive by the structured request.
+    /// \param structured_request Receives the request, its method, its Request-URI and its version.
+    /// \param rest Set to the part of the request following the Request-Line.
+    /// \returns The parsing status, the version may still be unknown when the line is valid.
+    static http_request::parsing_status parse_request_line(std::shared_ptr<const std::string> request, http_request_view& structured_request,
+                                                           boost::string_view& rest) noexcept;
 
     /// \brief Obtain a handle to a version-specific executor of the http protocol.
-    /// make_handler lazily creates a single static instance of the concrete strategy
-    /// used to answer to requests of a specific profocol version. When the concrete
-    /// instance is created once, it is stored and reused for subsequent requests.
-    /// \note http_protocol_handler handles dynamic allocation.
+    /// The cache holds a single instance of the concrete strategy used to answer to
+    /// requests of each protocol version, which is reused for every request.
     ///
-    /// \param http_version The string matching the http version. e.g.: 'HTTP/1.1'.
-    /// \returns A pointer to the protocol handler or nullptr if the version is invalid.
-    static http_protocol_handler* get_handler(http_protocol_handler_cache& cache, const std::string& http_version) noexcept;
+    /// \param http_version The http version of the request, see parse_request_line.
+    /// \returns A pointer to the protocol handler or nullptr if the version is unknown.
+    static http_protocol_handler* get_handler(const http_protocol_handler_cache& cache, http_constants::version http_version) noexcept;
 
-    /// \brief Parse an http request according to the version.
+    /// \brief Parse the headers and the message body of an http request according to the version.
     ///
-    /// \param request The entire http request in string.
-    /// \param structured_request The structured request to fill during parsing.
+    /// \param rest The part of the request following its Request-Line, a slice of structured_request.buffer.
+    /// \param structured_request The structured request to fill during parsing, whose Request-Line was parsed.
     /// \returns The parsing status.
-    virtual http_request::parsing_status parse_request(const std::string& request, http_request& structured_request) const noexcept = 0;
+    virtual http_request::parsing_status parse_request(boost::string_view rest, http_request_view& structured_request) const noexcept = 0;
 
     /// \brief Creates a basic response for a specific protocol version.
     ///
     /// \returns A valid default response for the protocol version.
     virtual http_response make_response(const generic_response& gresponse) const noexcept = 0;
 
-private:
-    template <typename T>
-    static http_protocol_handler* make_handle_impl(http_protocol_handler_cache& cache) noexcept;
+protected:
+    /// \brief Slice of a request between two pointers, without the carriage return ending a line.
+    static boost::string_view slice(const char* begin, const char* end) noexcept;
 };
 
 #endif
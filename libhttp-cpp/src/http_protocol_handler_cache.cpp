@@ -6,21 +6,24 @@
 // Class declaration
 #include "http_protocol_handler_cache.h"
 
-bool http_protocol_handler_cache::contains(const key_type& key) const noexcept
-{
-    const auto it = cache_.find(key);
-    return (it != cache_.cend());
-}
+///////////////////////////////////////////////////////////
+// Include all supported http protocol version
+#include "http_protocol_one_one.h"
+#include "http_protocol_one_zero.h"
 
-http_protocol_handler_cache::raw_value_type http_protocol_handler_cache::get(const key_type& key) const
+constexpr size_t http_protocol_handler_cache::VERSION_COUNT;
+
+http_protocol_handler_cache::http_protocol_handler_cache()
 {
-    return cache_.at(key).get();
+    cache_[static_cast<size_t>(http_constants::version::http_1_0)] = std::make_unique<http_protocol_one_zero>();
+    cache_[static_cast<size_t>(http_constants::version::http_1_1)] = std::make_unique<http_protocol_one_one>();
 }
 
-http_protocol_handler_cache::raw_value_type http_protocol_handler_cache::insert(key_type&& key, value_type&& value)
+// The destructor is defined once the declaration of 'http_protocol_handler' is known.
+http_protocol_handler_cache::~http_protocol_handler_cache() = default;
+
+http_protocol_handler_cache::raw_value_type http_protocol_handler_cache::get(key_type key) const noexcept
 {
-    auto pair = cache_.emplace(std::move(key), std::move(value));
-    if (pair.second)
-        return pair.first->second.get();
-    return nullptr;
+    const size_t index = static_cast<size_t>(key);
+    return (index < cache_.size()) ? cache_[index].get() : nullptr;
 }
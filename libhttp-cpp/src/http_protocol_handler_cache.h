@@ -1,35 +1,39 @@
 #ifndef HTTP_PROTOCOL_HANDLER_CACHE_H
 #define HTTP_PROTOCOL_HANDLER_CACHE_H
 
-#include <map>
+#include <array>
+#include <cstddef>
 #include <memory>
-#include <string>
+
+#include "http_constants.h"
 
 // Forward declaration of the http protocol handler.
 class http_protocol_handler;
 
+/// \brief Protocol handler of every http version, indexed by http_constants::version.
+///
+/// The handlers are created along with the cache, a lookup is a mere index and the cache can be shared by
+/// every thread without locking.
 class http_protocol_handler_cache {
 public:
-    using key_type = std::string;
+    using key_type = http_constants::version;
     using value_type = std::unique_ptr<http_protocol_handler>;
     using raw_value_type = http_protocol_handler*;
 
-    http_protocol_handler_cache() = default;
-    ~http_protocol_handler_cache() = default;
+    http_protocol_handler_cache();
+    ~http_protocol_handler_cache();
     http_protocol_handler_cache(const http_protocol_handler_cache&) = delete;
     http_protocol_handler_cache& operator=(const http_protocol_handler_cache&) = delete;
     http_protocol_handler_cache(http_protocol_handler_cache&&) = default;
     http_protocol_handler_cache& operator=(http_protocol_handler_cache&&) = default;
 
-    bool contains(const key_type& key) const noexcept;
-
-    raw_value_type get(const key_type& key) const;
-    raw_value_type insert(key_type&& key, value_type&& value);
+    /// \returns The handler of the version, nullptr for http_constants::version::unknown.
+    raw_value_type get(key_type key) const noexcept;
 
 private:
-    using map_type = std::map<key_type, value_type>;
+    static constexpr size_t VERSION_COUNT = static_cast<size_t>(http_constants::version::http_1_1) + 1;
 
-    map_type    cache_;
+    std::array<value_type, VERSION_COUNT> cache_;
 };
 
 #endif
@@ -1,5 +1,6 @@
 #include "http_protocol_one_one.h"
 
+#include <algorithm>
 #include <cassert>
 #include <exception>
 #include <sstream>
@@ -7,12 +8,22 @@
 
 #include "interface/http_resource.h"
 #include "http_resource_factory.h"
+#include "http_scanner.h"
 #include "http_structure.hpp"
 
-#include <boost/algorithm/string.hpp>
-
 #include "logger.h"
 
+namespace
+{
+
+// Headers sent by a typical browser, the list of the headers of a request is sized for them at once.
+constexpr size_t EXPECTED_HEADERS = 16;
+
+// Delimiters of the fields of a header line, each line is scanned once for the first of them.
+constexpr char HEADER_DELIMITERS[] = {':', '\n'};
+
+}
+
 constexpr decltype(http_protocol_one_one::http_version) http_protocol_one_one::http_version;
 
 http_protocol_one_one::http_protocol_one_one() noexcept :
@@ -24,95 +35,52 @@ http_protocol_one_one::http_protocol_one_one() noexcept :
 }
 
 
-http_request::parsing_status http_protocol_one_one::parse_request(const std::string& request, http_request& structured_request) const noexcept
+http_request::parsing_status http_protocol_one_one::parse_request(boost::string_view rest, http_request_view& structured_request) const noexcept
 {
-	if (request.empty())
-		return http_request::parsing_status::empty_request;
-
-	std::string request_line;
-	std::istringstream input(request);
+	using string_view = http_request_view::string_view;
 
-	///////////////////////////////////////////////////////
-	// Parse HTTP request
-	//   Request-Line = Method SP Request-URI SP HTTP-Version
-	std::getline(input, request_line);
-
-	std::vector<std::string> request_line_split;
-	boost::split(request_line_split, request_line, boost::is_space());
-	if (request_line_split.size() > 0 && request_line_split.back().length() == 0) {
-		request_line_split.pop_back();
-	}
-
-	if (request_line_split.size() != 3)
-		return http_request::parsing_status::invalid_request_line;
-
-	const std::string raw_method = request_line_split[0];
-	const std::string raw_request_uri = request_line_split[1];
-	const std::string raw_http_version = request_line_split[2];
-
-	const auto find_iter =
-	    std::find(std::cbegin(http_constants::METHODS), std::cend(http_constants::METHODS), raw_method);
-	if (find_iter == std::cend(http_constants::METHODS))
-		return http_request::parsing_status::invalid_request_line;
-	const size_t find_index = std::distance(std::cbegin(http_constants::METHODS), find_iter);
-
-	structured_request.method = static_cast<http_constants::method>(find_index);
-	structured_request.request_uri = raw_request_uri;
-	structured_request.http_version = raw_http_version;
+	const char* position = rest.data();
+	const char* end = position + rest.size();
 
 	///////////////////////////////////////////////////////
 	// Parse HTTP headers
 	//   *(( general-header | request-header | entity-header ) CRLF) CRLF
-	for (std::string line; std::getline(input, line) && !line.empty();) {
-		const size_t colon_position = line.find_first_of(":");
-		if (colon_position == std::string::npos)
-			continue;
-		if (line.length() < 2)
+	structured_request.header.clear();
+	structured_request.header.reserve(EXPECTED_HEADERS);
+	while (position != end) {
+		// The name of a header ends at its colon, a line without one ends first.
+		const char* line = position;
+		const char* name_end = http_scanner::find_first_of(position, end, HEADER_DELIMITERS, 2);
+		const char* line_end = (name_end != end && *name_end == ':') ? http_scanner::find(name_end + 1, end, '\n') : name_end;
+		position = (line_end != end) ? line_end + 1 : end;
+
+		if (slice(line, line_end).empty())
+			break;
+		if (name_end == line_end)
 			continue;
 
-		if (line.back() == '\n') line.pop_back();
-		if (line.back() == '\r') line.pop_back();
-
-		std::string header(line.substr(0, colon_position));
-		std::string property(line.substr(colon_position + 2));
-
-		const auto general_iter =
-		    std::find(std::cbegin(http_constants::GENERAL_HEADER), std::cend(http_constants::GENERAL_HEADER), header);
-		const auto request_iter =
-		    std::find(std::cbegin(http_constants::REQUEST_HEADER), std::cend(http_constants::REQUEST_HEADER), header);
-		const auto entity_iter =
-		    std::find(std::cbegin(http_constants::ENTITY_HEADER), std::cend(http_constants::ENTITY_HEADER), header);
-
-		if (general_iter != std::cend(http_constants::GENERAL_HEADER)) {
-			structured_request.general_header.emplace(header, property);
-		} else if (request_iter != std::cend(http_constants::REQUEST_HEADER)) {
-			structured_request.request_header.emplace(header, property);
-		} else if (entity_iter  != std::cend(http_constants::REQUEST_HEADER)) {
-			structured_request.entity_header.emplace(header, property);
-		} else {
-			assert(false);
-		}
+		// The value is surrounded by optional whitespaces.
+		string_view property = slice(name_end + 1, line_end);
+		while (!property.empty() && (property.front() == ' ' || property.front() == '\t'))
+			property.remove_prefix(1);
+		while (!property.empty() && (property.back() == ' ' || property.back() == '\t'))
+			property.remove_suffix(1);
 
+		const string_view name = slice(line, name_end);
+		structured_request.header.push_back(http_request_view::header_field{
+			name, property, http_constants::find_header(name.data(), name.size())});
 	}
 
 	///////////////////////////////////////////////////////
 	// Parse message body
-	structured_request.message_body = "";
-	if (input.tellg() < request.size())
-		structured_request.message_body = request.substr(input.tellg());
+	structured_request.message_body = string_view(position, static_cast<size_t>(end - position));
 
 	///////////////////////////////////////////////////////
 	// Print out the request to the console
-
-	std::string printable_request_line = request_line;
-	boost::replace_all(printable_request_line, "\r", "" /*"\\r"*/);
-	logger::log()->trace() << printable_request_line;
-	for (const auto& h : structured_request.general_header)
-		logger::log()->trace() << h.first << ":" << h.second;
-	for (const auto& h : structured_request.request_header)
-		logger::log()->trace() << h.first << ":" << h.second;
-	for (const auto& h : structured_request.entity_header)
-		logger::log()->trace() << h.first << ":" << h.second;
+	logger::log()->trace() << structured_request.method << " " << structured_request.request_uri
+	                       << " " << structured_request.http_version;
+	for (const auto& h : structured_request.header)
+		logger::log()->trace() << h.name << ":" << h.value;
 
 	return http_request::parsing_status::success;
 }
@@ -16,12 +16,12 @@ public:
     http_protocol_one_one() noexcept;
     virtual ~http_protocol_one_one() = default;
 
-    /// \brief Parse an http request according to the version.
+    /// \brief Parse the headers and the message body of an http request according to the version.
     ///
-    /// \param request The entire http request in string.
-    /// \param structured_request The structured request to fill during parsing.
+    /// \param rest The part of the request following its Request-Line, a slice of structured_request.buffer.
+    /// \param structured_request The structured request to fill during parsing, whose Request-Line was parsed.
     /// \returns The parsing status.
-    virtual http_request::parsing_status parse_request(const std::string& request, http_request& structured_request) const noexcept override;
+    virtual http_request::parsing_status parse_request(boost::string_view rest, http_request_view& structured_request) const noexcept override;
 
     /// \brief Creates a basic response for a specific protocol version.
     ///
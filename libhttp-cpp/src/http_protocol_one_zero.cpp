@@ -13,7 +13,7 @@ http_protocol_one_zero::http_protocol_one_zero() noexcept :
 
 }
 
-http_request::parsing_status http_protocol_one_zero::parse_request(const std::string& request, http_request& structured_request) const noexcept
+http_request::parsing_status http_protocol_one_zero::parse_request(boost::string_view rest, http_request_view& structured_request) const noexcept
 {
     // TODO: Implement the parsing of an HTTP 1.0 request.
     return http_request::parsing_status::success;
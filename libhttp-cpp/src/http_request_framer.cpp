@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////
+// Class declaration
+#include "http_request_framer.h"
+
+///////////////////////////////////////////////////////////
+// Other includes
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+#include "http_constants.h"
+#include "http_scanner.h"
+
+constexpr size_t http_request_framer::MAX_HEADER_LENGTH;
+
+namespace
+{
+
+bool iequals(const char* lhs, size_t lhs_length, const char* rhs) noexcept
+{
+    const size_t rhs_length = std::strlen(rhs);
+    if (lhs_length != rhs_length)
+        return false;
+    for (size_t i = 0; i < lhs_length; ++i) {
+        if (std::tolower(static_cast<unsigned char>(lhs[i])) != std::tolower(static_cast<unsigned char>(rhs[i])))
+            return false;
+    }
+    return true;
+}
+
+}
+
+http_request_framer::http_request_framer(size_t max_content_length /* = 0 */) noexcept :
+    max_content_length_(max_content_length)
+{
+    reset();
+}
+
+void http_request_framer::reset() noexcept
+{
+    stage_ = stage::header;
+    begin_ = 0;
+    scanned_ = 0;
+    line_begin_ = 0;
+    header_end_ = 0;
+    content_length_ = 0;
+    has_content_length_ = false;
+}
+
+http_request_framer::status http_request_framer::consume(const char* buffer, size_t length) noexcept
+{
+    ///////////////////////////////////////////////////////
+    // Scan the header line by line, resuming where the previous call stopped:
+    //   Request = Request-Line CRLF *(message-header CRLF) CRLF [ message-body ]
+    while (stage_ == stage::header && scanned_ < length) {
+        // Jump to the end of the line, the bytes in between are compared by blocks.
+        scanned_ = static_cast<size_t>(http_scanner::find(buffer + scanned_, buffer + length, '\n') - buffer);
+        if (scanned_ == length)
+            break;
+        // A header received at once is bounded as well as one growing across calls.
+        if (scanned_ - begin_ > MAX_HEADER_LENGTH) {
+            stage_ = stage::invalid;
+            break;
+        }
+
+        size_t line_end = scanned_;
+        if (line_end > line_begin_ && buffer[line_end - 1] == '\r')
+            --line_end;
+        const size_t line_length = line_end - line_begin_;
+
+        if (line_length == 0) {
+            if (line_begin_ == begin_) {
+                // RFC2616 section 4.1: ignore the empty lines received before the Request-Line.
+                begin_ = line_begin_ = ++scanned_;
+                continue;
+            }
+            // The end of the request must neither wrap around nor leave the message-body past its limit.
+            header_end_ = scanned_ + 1;
+            if (content_length_ > std::numeric_limits<size_t>::max() - header_end_ ||
+                (max_content_length_ != 0 && content_length_ > max_content_length_))
+                stage_ = stage::too_large;
+            else
+                stage_ = stage::body;
+        } else if (line_begin_ != begin_ && !parse_header_line(buffer + line_begin_, line_length)) {
+            stage_ = stage::invalid;
+        }
+        line_begin_ = ++scanned_;
+    }
+
+    switch (stage_) {
+        case stage::header:
+            return (scanned_ - begin_ > MAX_HEADER_LENGTH) ? status::invalid : status::incomplete;
+        case stage::body:
+            return (length >= request_end()) ? status::complete : status::incomplete;
+        case stage::too_large:
+            return status::too_large;
+        case stage::invalid:
+        default:
+            return status::invalid;
+    }
+}
+
+bool http_request_framer::parse_header_line(const char* line, size_t length) noexcept
+{
+    // Only the headers delimiting the message-body matter:
+    //   message-header = field-name ":" [ field-value ]
+    const char* colon = static_cast<const char*>(std::memchr(line, ':', length));
+    if (colon == nullptr)
+        return true;
+
+    const size_t name_length = static_cast<size_t>(colon - line);
+    const char* value = colon + 1;
+    const char* value_end = line + length;
+    while (value < value_end && (*value == ' ' || *value == '\t'))
+        ++value;
+    while (value_end > value && (*(value_end - 1) == ' ' || *(value_end - 1) == '\t'))
+        --value_end;
+
+    const http_constants::header_id header = http_constants::find_header(line, name_length);
+    if (header == http_constants::header_id::content_length) {
+        if (value == value_end)
+            return false;
+
+        size_t content_length = 0;
+        for (const char* it = value; it != value_end; ++it) {
+            if (!std::isdigit(static_cast<unsigned char>(*it)))
+                return false;
+            const size_t digit = static_cast<size_t>(*it - '0');
+            if (content_length > (std::numeric_limits<size_t>::max() - digit) / 10)
+                return false;
+            content_length = content_length * 10 + digit;
+        }
+
+        // RFC7230 section 3.3.2: differing Content-Length values make the message invalid.
+        if (has_content_length_ && content_length != content_length_)
+            return false;
+        content_length_ = content_length;
+        has_content_length_ = true;
+        return true;
+    }
+
+    if (header == http_constants::header_id::transfer_encoding) {
+        // Chunked request bodies are not supported, their length cannot be known from the header.
+        return iequals(value, static_cast<size_t>(value_end - value), "identity");
+    }
+
+    return true;
+}
@@ -53,7 +53,9 @@ http_filesystem_resource_factory::http_filesystem_resource_factory(const std::st
 
 std::unique_ptr<http_resource> http_filesystem_resource_factory::create_handle(const generic_request& request) const noexcept
 {
-    std::string path = virtual_path_ + request.request_uri;
+    // The query does not name a file.
+    std::string path = virtual_path_;
+    path.append(request.abs_path.data(), request.abs_path.size());
     assert(path.length() > 0);
 
     if (!boost::filesystem::exists(path)) {
@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////
+// Class declaration
+#include "http_scanner.h"
+
+///////////////////////////////////////////////////////////
+// Other includes
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#  define HTTP_SCANNER_X86
+#  include <immintrin.h>
+#endif
+
+constexpr size_t http_scanner::MAX_DELIMITERS;
+
+namespace
+{
+
+using find_fn = const char* (*)(const char*, const char*, const char*, size_t);
+
+// Search of the few bytes following the last block.
+const char* find_first_of_tail(const char* begin, const char* end, const char* delimiters, size_t count) noexcept
+{
+    return std::find_first_of(begin, end, delimiters, delimiters + count);
+}
+
+const char* find_first_of_scalar(const char* begin, const char* end, const char* delimiters, size_t count) noexcept
+{
+    bool delimiter_set[256] = {};
+    for (size_t i = 0; i < count; ++i)
+        delimiter_set[static_cast<unsigned char>(delimiters[i])] = true;
+
+    for (; begin != end; ++begin) {
+        if (delimiter_set[static_cast<unsigned char>(*begin)])
+            return begin;
+    }
+    return end;
+}
+
+#if defined(HTTP_SCANNER_X86)
+
+__attribute__((target("sse4.2")))
+const char* find_first_of_sse42(const char* begin, const char* end, const char* delimiters, size_t count) noexcept
+{
+    // The delimiters are compared to every byte of a block at once, as in picohttpparser.
+    char set[16] = {};
+    std::memcpy(set, delimiters, count);
+    const __m128i delimiter_set = _mm_loadu_si128(reinterpret_cast<const __m128i*>(set));
+
+    for (; end - begin >= 16; begin += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const int index = _mm_cmpestri(delimiter_set, static_cast<int>(count), block, 16,
+                                       _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+        if (index != 16)
+            return begin + index;
+    }
+    return find_first_of_tail(begin, end, delimiters, count);
+}
+
+__attribute__((target("avx2")))
+const char* find_first_of_avx2(const char* begin, const char* end, const char* delimiters, size_t count) noexcept
+{
+    __m256i delimiter_set[http_scanner::MAX_DELIMITERS];
+    for (size_t i = 0; i < count; ++i)
+        delimiter_set[i] = _mm256_set1_epi8(delimiters[i]);
+
+    for (; end - begin >= 32; begin += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        __m256i matches = _mm256_cmpeq_epi8(block, delimiter_set[0]);
+        for (size_t i = 1; i < count; ++i)
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block, delimiter_set[i]));
+
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+        if (mask != 0)
+            return begin + __builtin_ctz(mask);
+    }
+
+    // A line often ends within the 16 bytes following the last block.
+    if (end - begin >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        __m128i matches = _mm_cmpeq_epi8(block, _mm256_castsi256_si128(delimiter_set[0]));
+        for (size_t i = 1; i < count; ++i)
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, _mm256_castsi256_si128(delimiter_set[i])));
+
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+        if (mask != 0)
+            return begin + __builtin_ctz(mask);
+        begin += 16;
+    }
+    return find_first_of_tail(begin, end, delimiters, count);
+}
+
+#endif
+
+find_fn implementation(http_scanner::isa instruction_set) noexcept
+{
+    switch (instruction_set) {
+#if defined(HTTP_SCANNER_X86)
+        case http_scanner::isa::avx2:
+            return &find_first_of_avx2;
+        case http_scanner::isa::sse42:
+            return &find_first_of_sse42;
+#endif
+        case http_scanner::isa::scalar:
+        default:
+            return &find_first_of_scalar;
+    }
+}
+
+http_scanner::isa selected_isa = http_scanner::detect();
+find_fn selected_find = implementation(selected_isa);
+
+}
+
+const char* http_scanner::find_first_of(const char* begin, const char* end, const char* delimiters, size_t count) noexcept
+{
+    // The C library already compares the bytes by blocks when searching a single one.
+    if (count == 1) {
+        const void* found = std::memchr(begin, delimiters[0], static_cast<size_t>(end - begin));
+        return (found != nullptr) ? static_cast<const char*>(found) : end;
+    }
+    return selected_find(begin, end, delimiters, std::min(count, MAX_DELIMITERS));
+}
+
+http_scanner::isa http_scanner::detect() noexcept
+{
+#if defined(HTTP_SCANNER_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return isa::avx2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return isa::sse42;
+#endif
+    return isa::scalar;
+}
+
+http_scanner::isa http_scanner::selected() noexcept
+{
+    return selected_isa;
+}
+
+bool http_scanner::select(isa instruction_set) noexcept
+{
+    if (instruction_set > detect())
+        return false;
+
+    selected_isa = instruction_set;
+    selected_find = implementation(instruction_set);
+    return true;
+}
@@ -15,7 +15,6 @@
 
 #include <cassert>
 #include <exception>
-#include <regex>
 #include <sstream>
 #include <string>
 
@@ -23,6 +22,64 @@
 
 #include "logger.h"
 
+namespace
+{
+
+// Detect the host of a request from its Request-URI, or from its Host header when it has none.
+void find_host(const http_request_uri& uri, boost::string_view request_uri, const boost::string_view* host_header,
+               boost::string_view& name, uint16_t& port)
+{
+    boost::string_view digits;
+    switch (uri.type) {
+        case http_request_uri::form::absolute_uri:
+        case http_request_uri::form::authority:
+            // In this case, RFC2616:5.2 says to ignore any host header.
+            name = uri.host;
+            digits = uri.port;
+            break;
+
+        case http_request_uri::form::abs_path:
+            // Make sure that the host header exists.
+            if (host_header == nullptr) {
+                logger::log()->warn() << "The 'Host' header must be provided for absolute-path requests.";
+                throw http_invalid_request("'Host' header is missing.");
+            }
+            if (!http_request_uri::parse_authority(*host_header, name, digits)) {
+                logger::log()->warn() << "Invalid Host header: " << *host_header;
+                throw std::invalid_argument("Invalid Host header in the request.");
+            }
+            break;
+
+        case http_request_uri::form::asterisk:
+            // Nothing to do.
+            name = "*";
+            break;
+
+        case http_request_uri::form::invalid:
+        default:
+            logger::log()->warn() << "Invalid Request-URI: " << request_uri;
+            throw std::invalid_argument("Invalid Request-URI parameter in the request, could not detect a valid format.");
+    }
+
+    // The authorities were checked as they were split, the port is valid.
+    http_request_uri::parse_port(digits, port);
+}
+
+// Components of the Request-URI of the generic request, slices of its own copy of the Request-URI.
+void set_uri(generic_request& grequest, const http_request_uri& uri, boost::string_view request_uri)
+{
+    const auto rebase = [&grequest, request_uri](boost::string_view part) {
+        return boost::string_view(grequest.request_uri).substr(static_cast<size_t>(part.data() - request_uri.data()), part.size());
+    };
+
+    if (uri.type == http_request_uri::form::absolute_uri || uri.type == http_request_uri::form::abs_path) {
+        grequest.abs_path = rebase(uri.abs_path);
+        grequest.query = uri.query.empty() ? boost::string_view() : rebase(uri.query);
+    }
+}
+
+}
+
 std::unique_ptr<http_protocol_handler_cache> http_service::protocol_handler_cache_(std::make_unique<http_protocol_handler_cache>());
 
 http_service::http_service(const std::string& service_path, host&& host, const std::string& name /* = "" */) :
@@ -37,16 +94,24 @@ http_service::~http_service() = default;
 
 http_request http_service::parse_request(const std::string& request)
 {
-    http_request structured_request;
-    const std::string http_version = http_protocol_handler::extract_http_version(request);
+    return parse_request_view(std::make_shared<const std::string>(request)).to_request();
+}
+
+http_request_view http_service::parse_request_view(std::shared_ptr<const std::string> request)
+{
+    http_request_view structured_request;
+    boost::string_view rest;
+    http_request::parsing_status code = http_protocol_handler::parse_request_line(std::move(request), structured_request, rest);
+    if (code != http_request::parsing_status::success)
+        throw http_invalid_request("Invalid request.");
 
     assert(protocol_handler_cache_);
-    http_protocol_handler* handler = http_protocol_handler::get_handler(*protocol_handler_cache_.get(), http_version);
+    const http_protocol_handler* handler = http_protocol_handler::get_handler(*protocol_handler_cache_, structured_request.version);
     if (handler == nullptr) {
         // TODO: Assume that a wrong/not-implemented http version is a bad request for now.
         throw http_invalid_request("Invalid request.");
     } else {
-        http_request::parsing_status code = handler->parse_request(request, structured_request);
+        code = handler->parse_request(rest, structured_request);
 
         // TODO: Handle parsing return code.
         if (code != http_request::parsing_status::success) {
@@ -77,7 +142,7 @@ std::string http_service::execute(const std::string& request) const
     return response_stream.str();
 }
 
-http_response http_service::execute(const http_request& request) const
+http_response http_service::execute(const http_request& request, bool allow_file_body /* = false */) const
 {
     // Execute an http request as follows:
     // 1. Identify http version & get handle to parser.
@@ -101,10 +166,40 @@ http_response http_service::execute(const http_request& request) const
     ///////////////////////////////////////////////////
     // 4. Create generic request & response.
     generic_request grequest = request.to_generic();
+    grequest.file_body_allowed = allow_file_body;
+    set_uri(grequest, http_request_uri::parse(request.request_uri), request.request_uri);
+    return execute(grequest, http_constants::find_version(request.http_version.data(), request.http_version.size()));
+}
+
+http_response http_service::execute(const http_request_view& request, bool allow_file_body /* = false */) const
+{
+    // The host is compared in place, only the fields referenced by the generic request are copied out of it.
+    const http_request_view::header_field* host_header = request.find_header(http_constants::header_id::host);
+    boost::string_view detected_name;
+    uint16_t detected_port;
+    find_host(request.uri, request.request_uri, (host_header != nullptr) ? &host_header->value : nullptr,
+              detected_name, detected_port);
+    if (detected_name != host_.name || detected_port != host_.port)
+        logger::log()->warn() << "Non-matching host, expected '" << host_ << "' but got '" << detected_name << ":" << detected_port << "'.";
+
+    const std::string request_uri(request.request_uri.data(), request.request_uri.size());
+    const std::string message_body(request.message_body.data(), request.message_body.size());
+    generic_request grequest(request.method, request_uri, message_body);
+    grequest.file_body = request.file_body;
+    grequest.file_body_allowed = allow_file_body;
+    set_uri(grequest, request.uri, request.request_uri);
+    for (const auto& h : request.header)
+        grequest.header.emplace(std::string(h.name.data(), h.name.size()), std::string(h.value.data(), h.value.size()));
+
+    return execute(grequest, request.version);
+}
+
+http_response http_service::execute(generic_request& grequest, http_constants::version http_version) const
+{
     generic_response gresponse;
 
     assert(protocol_handler_cache_);
-    http_protocol_handler* handler = http_protocol_handler::get_handler(*protocol_handler_cache_.get(), request.http_version);
+    const http_protocol_handler* handler = http_protocol_handler::get_handler(*protocol_handler_cache_, http_version);
     if (handler == nullptr) {
         gresponse.status_code = http_constants::status::http_bad_request;
     } else {
@@ -150,77 +245,24 @@ http_response http_service::execute(const http_request& request) const
 
 http_service::host http_service::extract_host(const http_request& request)
 {
-    // Check if the Request-URI is an absoluteURI of the following form:
-    // "http:" "//" host [ ":" port ] [ abs_path [ "?" query ]]
-    static std::regex absolute_uri_regex("http:\\/\\/([^\\/:]+)(:([0-9]+))?([^\\?]*)(\\?(.*))?", std::regex_constants::ECMAScript | std::regex_constants::optimize);
-    static std::regex absolute_path_regex("(\\/([^\\?]*))(\\?(.*))?", std::regex_constants::ECMAScript | std::regex_constants::optimize);
-    static std::regex host_regex("([^\\/:]+)(:([0-9]+))?", std::regex_constants::ECMAScript | std::regex_constants::optimize);
-
-    std::smatch matches;
-    if (std::regex_match(request.request_uri, matches, absolute_uri_regex)) {
-
-        // In this case, RFC2616:5.2 says to ignore any host header.
-        // We rewrite it in the request_header field.
-
-        const std::string raw_host = matches[1];
-        const std::string raw_port = matches[3];
-        const std::string raw_abs_path = matches[4];
-        const std::string raw_query = matches[6];
-
-        logger::log()->trace() << "Absolute URI detected: ";
-        logger::log()->trace() << " - Host: " << raw_host << "(" << raw_port << ")";
-        logger::log()->trace() << " - Abs_path: " << raw_abs_path;
-        logger::log()->trace() << " - Query: " << raw_query;
-
-        // Set default port to 80.
-        uint16_t port;
-        std::istringstream ss(raw_port);
-        ss >> port;
-        if (!ss) port = 80;
-
-        return host{raw_host, port};
-    }
-
-    if (std::regex_match(request.request_uri, matches, absolute_path_regex)) {
-        // Make sure that the host header exists.
-        const auto host_it = request.request_header.find("Host");
-        if (host_it == request.request_header.cend()) {
-            logger::log()->warn() << "The 'Host' header must be provided for absolute-path requests.";
-            throw http_invalid_request("'Host' header is missing.");
-        }
-
-        const std::string raw_abs_path = matches[1];
-        const std::string raw_query = matches[4];
-
-        logger::log()->trace() << "Absolute path detected: ";
-        logger::log()->trace() << " - Host: " << host_it->second;
-        logger::log()->trace() << " - Abs_path: " << raw_abs_path;
-        logger::log()->trace() << " - Query: " << raw_query;
-
-        std::smatch host_matches;
-        if (std::regex_match(host_it->second, host_matches, host_regex)) {
-            const std::string raw_host = host_matches[1];
-            const std::string raw_port = host_matches[3];
-
-            // Set default port to 80.
-            uint16_t port;
-            std::istringstream ss(raw_port);
-            ss >> port;
-            if (!ss) port = 80;
-
-            return host{raw_host, port};
-        }
-    }
-
-    if (request.request_uri == "*") {
-        // Nothing to do.
-        return host{"*", 80};
-    }
+    const auto host_it = request.request_header.find("Host");
+    const boost::string_view host_header = (host_it != request.request_header.cend()) ? host_it->second : boost::string_view();
+
+    boost::string_view name;
+    uint16_t port;
+    find_host(http_request_uri::parse(request.request_uri), request.request_uri,
+              (host_it != request.request_header.cend()) ? &host_header : nullptr, name, port);
+    return host{name.to_string(), port};
+}
 
-    // TODO: Handle 'authority'-based request.
+http_service::host http_service::extract_host(const http_request_view& request)
+{
+    const http_request_view::header_field* host_header = request.find_header(http_constants::header_id::host);
 
-    logger::log()->warn() << "Invalid Request-URI: " << request.request_uri;
-    throw std::invalid_argument("Invalid Request-URI parameter in the request, could not detect a valid format.");
+    boost::string_view name;
+    uint16_t port;
+    find_host(request.uri, request.request_uri, (host_header != nullptr) ? &host_header->value : nullptr, name, port);
+    return host{name.to_string(), port};
 }
 
 ///////////////////////////////////////////////////////////
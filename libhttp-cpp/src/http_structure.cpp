@@ -11,17 +11,193 @@
 #include <sstream>
 #include <tuple>
 
+namespace
+{
+
+bool iequals(boost::string_view lhs, boost::string_view rhs) noexcept
+{
+    return lhs.size() == rhs.size() &&
+           std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin(),
+                      [](char l, char r) { return ::tolower(static_cast<unsigned char>(l)) == ::tolower(static_cast<unsigned char>(r)); });
+}
+
+}
+
 generic_request http_request::to_generic() const
 {
     generic_request grequest(method, request_uri, message_body);
+    grequest.file_body = file_body;
     grequest.header.insert(general_header.cbegin(), general_header.cend());
     grequest.header.insert(request_header.cbegin(), request_header.cend());
     grequest.header.insert(entity_header.cbegin(), entity_header.cend());
+    grequest.header.insert(extension_header.cbegin(), extension_header.cend());
 
     return grequest;
 }
 
+bool http_request::keep_alive() const
+{
+    bool close_token = false;
+    bool keep_alive_token = false;
+
+    const auto connection_it = general_header.find("Connection");
+    if (connection_it != general_header.cend()) {
+        std::istringstream tokens(connection_it->second);
+        for (std::string token; std::getline(tokens, token, http_constants::CM);) {
+            std::transform(token.begin(), token.end(), token.begin(), ::tolower);
+            token.erase(0, token.find_first_not_of(" \t"));
+            token.erase(token.find_last_not_of(" \t") + 1);
+
+            close_token |= (token == "close");
+            keep_alive_token |= (token == "keep-alive");
+        }
+    }
+
+    if (close_token)
+        return false;
+    if (http_version == "HTTP/1.0")
+        return keep_alive_token;
+    return true;
+}
+
+http_request_uri http_request_uri::parse(string_view request_uri) noexcept
+{
+    http_request_uri uri;
+    string_view path = request_uri;
+
+    if (request_uri == "*") {
+        uri.type = form::asterisk;
+        return uri;
+    }
+
+    constexpr string_view SCHEME("http://", 7);
+    if (iequals(request_uri.substr(0, SCHEME.size()), SCHEME)) {
+        // The authority of an absoluteURI ends with the path or the query.
+        path = request_uri.substr(SCHEME.size());
+        const size_t authority_end = path.find_first_of("/?");
+        if (!parse_authority(path.substr(0, authority_end), uri.host, uri.port) || uri.host.empty())
+            return uri;
+        path = (authority_end != string_view::npos) ? path.substr(authority_end) : string_view();
+        if (!path.empty() && path.front() != '/' && path.front() != '?')
+            return uri;
+        uri.type = form::absolute_uri;
+    } else if (!request_uri.empty() && request_uri.front() == '/') {
+        uri.type = form::abs_path;
+    } else {
+        // Only an authority with a port, anything else would be a relative path.
+        if (parse_authority(request_uri, uri.host, uri.port) && !uri.host.empty() && !uri.port.empty())
+            uri.type = form::authority;
+        return uri;
+    }
+
+    const size_t query_begin = path.find('?');
+    uri.abs_path = path.substr(0, query_begin);
+    if (query_begin != string_view::npos)
+        uri.query = path.substr(query_begin + 1);
+    return uri;
+}
+
+bool http_request_uri::parse_authority(string_view authority, string_view& host, string_view& port) noexcept
+{
+    const size_t colon = authority.find(':');
+    host = authority.substr(0, colon);
+    port = (colon != string_view::npos) ? authority.substr(colon + 1) : string_view();
+
+    if (host.empty() || host.find('/') != string_view::npos)
+        return false;
+    if (colon != string_view::npos && port.empty())
+        return false;
+
+    uint16_t number;
+    return parse_port(port, number);
+}
+
+bool http_request_uri::parse_port(string_view digits, uint16_t& port) noexcept
+{
+    if (digits.empty()) {
+        port = 80;
+        return true;
+    }
+
+    uint32_t number = 0;
+    for (const char c : digits) {
+        if (c < '0' || c > '9')
+            return false;
+        number = number * 10 + static_cast<uint32_t>(c - '0');
+        if (number > 0xffff)
+            return false;
+    }
+    port = static_cast<uint16_t>(number);
+    return true;
+}
+
+const http_request_view::header_field* http_request_view::find_header(string_view name) const noexcept
+{
+    const auto it = std::find_if(header.cbegin(), header.cend(), [name](const header_field& h) { return iequals(h.name, name); });
+    return (it != header.cend()) ? &*it : nullptr;
+}
+
+const http_request_view::header_field* http_request_view::find_header(http_constants::header_id id) const noexcept
+{
+    const auto it = std::find_if(header.cbegin(), header.cend(), [id](const header_field& h) { return h.id == id; });
+    return (it != header.cend()) ? &*it : nullptr;
+}
+
+bool http_request_view::keep_alive() const noexcept
+{
+    bool close_token = false;
+    bool keep_alive_token = false;
+
+    const header_field* connection = find_header(http_constants::header_id::connection);
+    if (connection != nullptr) {
+        string_view tokens = connection->value;
+        while (!tokens.empty()) {
+            const size_t comma = tokens.find(http_constants::CM);
+            string_view token = tokens.substr(0, comma);
+            tokens = (comma == string_view::npos) ? string_view() : tokens.substr(comma + 1);
+
+            while (!token.empty() && (token.front() == ' ' || token.front() == '\t'))
+                token.remove_prefix(1);
+            while (!token.empty() && (token.back() == ' ' || token.back() == '\t'))
+                token.remove_suffix(1);
+
+            close_token |= iequals(token, "close");
+            keep_alive_token |= iequals(token, "keep-alive");
+        }
+    }
+
+    if (close_token)
+        return false;
+    if (version == http_constants::version::http_1_0)
+        return keep_alive_token;
+    return true;
+}
+
+http_request http_request_view::to_request() const
+{
+    http_request request;
+    request.method = method;
+    request.request_uri.assign(request_uri.data(), request_uri.size());
+    request.http_version.assign(http_version.data(), http_version.size());
+    request.message_body.assign(message_body.data(), message_body.size());
+    request.file_body = file_body;
+
+    for (const auto& h : header) {
+        http_request::header_map* category = &request.extension_header;
+        switch (http_constants::get_header_class(h.id)) {
+            case http_constants::header_class::general: category = &request.general_header; break;
+            case http_constants::header_class::request: category = &request.request_header; break;
+            case http_constants::header_class::entity:  category = &request.entity_header;  break;
+            case http_constants::header_class::extension: break;
+        }
+        category->emplace(std::string(h.name.data(), h.name.size()), std::string(h.value.data(), h.value.size()));
+    }
+
+    return request;
+}
+
 http_response::http_response(const generic_response& gresponse, const std::string http_version) noexcept :
-    http_version(http_version), status_code(gresponse.status_code), message_body(gresponse.message_body)
+    http_version(http_version), status_code(gresponse.status_code), message_body(gresponse.message_body),
+    file_body(gresponse.file_body), body_producer(gresponse.message_body_complete ? nullptr : gresponse.body_producer)
 {
 }
@@ -0,0 +1,49 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+#include "interface/generic_body_stream.h"
+
+TEST (generic_body_stream_test, memory_body) {
+    const std::string uri = "/upload";
+    const std::string body = "hello world";
+    const generic_request request(http_constants::method::m_post, uri, body);
+
+    generic_body_stream stream(request);
+    EXPECT_EQ(body.size(), stream.length());
+    EXPECT_EQ(body, std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()));
+}
+
+TEST (generic_body_stream_test, file_body) {
+    const std::string uri = "/upload";
+    const std::string empty;
+    generic_request request(http_constants::method::m_put, uri, empty);
+
+    ///////////////////////////////////////////////////////
+    // The body spans several reads of the stream, past the offset of the file.
+    std::string content(200 * 1024, '\0');
+    for (size_t i = 0; i < content.size(); ++i)
+        content[i] = static_cast<char>('a' + i % 26);
+
+    FILE* file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+    const int fd = ::dup(::fileno(file));
+    std::fclose(file);
+    ASSERT_EQ(static_cast<ssize_t>(content.size()), ::write(fd, content.data(), content.size()));
+
+    request.file_body.descriptor = std::shared_ptr<const int>(new int(fd), [](const int* descriptor) {
+        ::close(*descriptor);
+        delete descriptor;
+    });
+    request.file_body.offset = 3;
+    request.file_body.length = content.size() - 3;
+
+    generic_body_stream stream(request);
+    EXPECT_EQ(content.size() - 3, stream.length());
+    EXPECT_EQ(content.substr(3), std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()));
+}
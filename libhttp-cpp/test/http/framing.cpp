@@ -0,0 +1,139 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "http_request_framer.h"
+
+TEST (http_request_framer_test, complete_request) {
+    const std::string request = "GET /basic.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    http_request_framer framer;
+    EXPECT_EQ(http_request_framer::status::complete, framer.consume(request.data(), request.size()));
+    EXPECT_EQ(0u, framer.request_begin());
+    EXPECT_EQ(request.size(), framer.request_end());
+}
+
+TEST (http_request_framer_test, split_header) {
+    const std::string request = "GET /basic.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    ///////////////////////////////////////////////////////
+    // Feed the request one byte at a time, as if every byte was a TCP segment.
+    http_request_framer framer;
+    for (size_t length = 1; length < request.size(); ++length) {
+        EXPECT_EQ(http_request_framer::status::incomplete, framer.consume(request.data(), length)) << "After " << length << " bytes.";
+    }
+    EXPECT_EQ(http_request_framer::status::complete, framer.consume(request.data(), request.size()));
+    EXPECT_EQ(request.size(), framer.request_end());
+}
+
+TEST (http_request_framer_test, content_length_body) {
+    const std::string header = "POST /form HTTP/1.1\r\nHost: localhost\r\ncontent-length:  11 \r\n\r\n";
+    const std::string request = header + "hello world";
+
+    http_request_framer framer;
+    EXPECT_EQ(http_request_framer::status::incomplete, framer.consume(request.data(), header.size() - 1));
+    EXPECT_FALSE(framer.header_complete());
+    EXPECT_EQ(http_request_framer::status::incomplete, framer.consume(request.data(), header.size()));
+    EXPECT_TRUE(framer.header_complete());
+    EXPECT_EQ(header.size(), framer.header_end());
+    EXPECT_EQ(11u, framer.content_length());
+
+    EXPECT_EQ(http_request_framer::status::incomplete, framer.consume(request.data(), request.size() - 1));
+    EXPECT_EQ(http_request_framer::status::complete, framer.consume(request.data(), request.size()));
+    EXPECT_EQ(request.size(), framer.request_end());
+}
+
+TEST (http_request_framer_test, leading_empty_lines) {
+    const std::string request = "\r\n\r\nGET / HTTP/1.1\r\n\r\n";
+
+    http_request_framer framer;
+    EXPECT_EQ(http_request_framer::status::complete, framer.consume(request.data(), request.size()));
+    EXPECT_EQ(4u, framer.request_begin()) << "RFC2616 section 4.1: servers SHOULD ignore any empty line(s) received where a Request-Line is expected.";
+    EXPECT_EQ(request.size(), framer.request_end());
+}
+
+TEST (http_request_framer_test, invalid_header) {
+    {
+        const std::string request = "POST / HTTP/1.1\r\nContent-Length: 12a\r\n\r\n";
+        http_request_framer framer;
+        EXPECT_EQ(http_request_framer::status::invalid, framer.consume(request.data(), request.size()));
+    }
+    {
+        const std::string request = "POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n";
+        http_request_framer framer;
+        EXPECT_EQ(http_request_framer::status::invalid, framer.consume(request.data(), request.size())) << "RFC7230 section 3.3.2: differing Content-Length values are invalid.";
+    }
+    {
+        const std::string request = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+        http_request_framer framer;
+        EXPECT_EQ(http_request_framer::status::invalid, framer.consume(request.data(), request.size()));
+    }
+    {
+        const std::string request = "GET / HTTP/1.1\r\nX-Padding: " + std::string(http_request_framer::MAX_HEADER_LENGTH, 'a');
+        http_request_framer framer;
+        EXPECT_EQ(http_request_framer::status::invalid, framer.consume(request.data(), request.size()));
+    }
+}
+
+TEST (http_request_framer_test, too_large) {
+    {
+        // The end of the request would wrap around, leaving it complete without its message-body.
+        const std::string request = "POST / HTTP/1.1\r\nContent-Length: 18446744073709551615\r\n\r\n";
+        http_request_framer framer;
+        EXPECT_EQ(http_request_framer::status::too_large, framer.consume(request.data(), request.size()));
+        EXPECT_FALSE(framer.header_complete());
+    }
+    {
+        const std::string request = "POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\nhello world";
+        http_request_framer limited(10);
+        EXPECT_EQ(http_request_framer::status::too_large, limited.consume(request.data(), request.size()));
+
+        // The limit outlives the request.
+        limited.reset();
+        EXPECT_EQ(http_request_framer::status::too_large, limited.consume(request.data(), request.size()));
+
+        http_request_framer exact(11);
+        EXPECT_EQ(http_request_framer::status::complete, exact.consume(request.data(), request.size()));
+    }
+    {
+        // A header longer than allowed is invalid even when it is received at once.
+        const std::string request = "GET / HTTP/1.1\r\nX-Padding: " + std::string(http_request_framer::MAX_HEADER_LENGTH, 'a') + "\r\n\r\n";
+        http_request_framer framer;
+        EXPECT_EQ(http_request_framer::status::invalid, framer.consume(request.data(), request.size()));
+    }
+}
+
+TEST (http_request_framer_test, reset) {
+    const std::string first = "POST /a HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc";
+    const std::string second = "GET /b HTTP/1.1\r\n\r\n";
+
+    http_request_framer framer;
+    EXPECT_EQ(http_request_framer::status::complete, framer.consume(first.data(), first.size()));
+    EXPECT_EQ(first.size(), framer.request_end());
+
+    framer.reset();
+    EXPECT_EQ(http_request_framer::status::complete, framer.consume(second.data(), second.size()));
+    EXPECT_EQ(0u, framer.content_length());
+    EXPECT_EQ(second.size(), framer.request_end());
+}
+
+TEST (http_request_framer_test, pipelined_requests) {
+    const std::string first = "POST /a HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc";
+    const std::string second = "GET /b HTTP/1.1\r\n\r\n";
+    const std::string buffer = first + second + "GET /c HTTP/1.1\r\n";
+
+    ///////////////////////////////////////////////////////
+    // Each request ends where the next one begins, the last one is still incomplete.
+    http_request_framer framer;
+    EXPECT_EQ(http_request_framer::status::complete, framer.consume(buffer.data(), buffer.size()));
+    EXPECT_EQ(first.size(), framer.request_end());
+
+    const std::string remaining = buffer.substr(framer.request_end());
+    framer.reset();
+    EXPECT_EQ(http_request_framer::status::complete, framer.consume(remaining.data(), remaining.size()));
+    EXPECT_EQ(second.size(), framer.request_end());
+
+    const std::string last = remaining.substr(framer.request_end());
+    framer.reset();
+    EXPECT_EQ(http_request_framer::status::incomplete, framer.consume(last.data(), last.size()));
+}
@@ -28,6 +28,37 @@ TEST_F (http_conformance_method_test, get) {
     EXPECT_FALSE(response.message_body.empty()) << "";
 }
 
+TEST_F (http_conformance_method_test, get_file_body) {
+    const std::string request = "GET /basic.html HTTP/1.1\r\nHost: method_conformance\r\n\r\n";
+    const http_request structured_request = http_service::parse_request(request);
+
+    const http_response response = service_->execute(structured_request, true);
+    const http_response memory_response = service_->execute(structured_request);
+
+    ///////////////////////////////////////////////////////
+    // The body is left in the file, with the same length as the one read in memory.
+    EXPECT_EQ(http_constants::status::http_ok, response.status_code);
+    EXPECT_TRUE(response.message_body.empty());
+    ASSERT_TRUE(static_cast<bool>(response.file_body));
+    EXPECT_EQ(0u, response.file_body.offset);
+    EXPECT_EQ(memory_response.message_body.size(), response.file_body.length);
+
+    const auto it = response.response_header.find("Content-Length");
+    ASSERT_NE(it, response.response_header.cend());
+    EXPECT_EQ(std::to_string(response.file_body.length), it->second);
+}
+
+TEST_F (http_conformance_method_test, get_query) {
+    const std::string request = "GET /basic.html?version=2 HTTP/1.1\r\nHost: method_conformance\r\n\r\n";
+    const http_request structured_request = http_service::parse_request(request);
+
+    ///////////////////////////////////////////////////////
+    // The query does not name a resource, the file is found by the path alone.
+    const http_response response = service_->execute(structured_request);
+    EXPECT_EQ(http_constants::status::http_ok, response.status_code);
+    EXPECT_FALSE(response.message_body.empty());
+}
+
 TEST_F (http_conformance_method_test, head) {
     const std::string request = "HEAD /basic.html HTTP/1.1\r\n\r\n";
     const http_request structured_request = http_service::parse_request(request);
@@ -99,11 +130,13 @@ TEST_F (http_conformance_method_test, post) {
 
         http_response response = service_->execute(structured_request);
 
-        EXPECT_EQ(http_constants::status::http_created, response.status_code) << "RFC2616 section 9.5: If a resource has been created on the origin server, the response SHOULD be 201 (Created).";
-        const auto it = response.response_header.find("Location");
-        EXPECT_NE(it, response.response_header.cend()) << "RFC2616 section 9.5: If a resource has been created on the origin server, the response SHOULD contain a Location header (see section 14.30).";
+        // The files of a website are only read.
+        EXPECT_EQ(http_constants::status::http_method_not_allowed, response.status_code);
+        const auto it = response.response_header.find("Allow");
+        EXPECT_NE(it, response.response_header.cend()) << "RFC2616 section 10.4.6: The response MUST include an Allow header containing a list of valid methods for the requested resource.";
         if (it != response.response_header.cend()) {
-            EXPECT_FALSE(it->second.empty());
+            EXPECT_EQ("GET, HEAD", it->second);
         }
+        EXPECT_TRUE(response.response_header.find("Content-Length") == response.response_header.cend());
     }
 }
@@ -0,0 +1,164 @@
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "http_exception.h"
+#include "http_service.h"
+
+TEST (http_request_view_test, slices_of_the_request) {
+    const auto request = std::make_shared<const std::string>(
+        "POST /form?id=1 HTTP/1.1\r\n"
+        "Host: localhost:8081\r\n"
+        "Connection:keep-alive\r\n"
+        "Content-Type: text/plain \r\n"
+        "X-Custom: value\r\n"
+        "\r\n"
+        "hello world");
+
+    const http_request_view view = http_service::parse_request_view(request);
+    EXPECT_EQ(http_constants::method::m_post, view.method);
+    EXPECT_EQ("/form?id=1", view.request_uri);
+    EXPECT_EQ("HTTP/1.1", view.http_version);
+    EXPECT_EQ("hello world", view.message_body);
+
+    ///////////////////////////////////////////////////////
+    // Every field points in the request, which the view keeps alive.
+    EXPECT_EQ(request, view.buffer);
+    const char* begin = request->data();
+    const char* end = begin + request->size();
+    EXPECT_TRUE(view.request_uri.data() >= begin && view.request_uri.data() + view.request_uri.size() <= end);
+    EXPECT_TRUE(view.message_body.data() >= begin && view.message_body.data() + view.message_body.size() <= end);
+
+    ///////////////////////////////////////////////////////
+    // The headers are kept in order, without their surrounding whitespaces.
+    ASSERT_EQ(4u, view.header.size());
+    EXPECT_EQ("Host", view.header[0].name);
+    EXPECT_EQ("localhost:8081", view.header[0].value);
+    EXPECT_EQ("keep-alive", view.header[1].value);
+    EXPECT_EQ("text/plain", view.header[2].value);
+
+    const http_request_view::header_field* content_type = view.find_header("content-type");
+    ASSERT_NE(nullptr, content_type);
+    EXPECT_EQ("text/plain", content_type->value);
+    EXPECT_EQ(nullptr, view.find_header("Accept"));
+
+    EXPECT_TRUE(view.keep_alive());
+    EXPECT_EQ(8081, http_service::extract_host(view).port);
+}
+
+TEST (http_request_view_test, owning_copy) {
+    const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\nAccept: */*\r\nContent-Length: 0\r\nX-Custom: value\r\n\r\n";
+
+    http_request structured_request;
+    {
+        const http_request_view view = http_service::parse_request_view(std::make_shared<const std::string>(request));
+        structured_request = view.to_request();
+    }
+
+    EXPECT_EQ(http_constants::method::m_get, structured_request.method);
+    EXPECT_EQ("/", structured_request.request_uri);
+    EXPECT_EQ("HTTP/1.1", structured_request.http_version);
+    EXPECT_TRUE(structured_request.message_body.empty());
+    EXPECT_EQ("localhost", structured_request.request_header.at("Host"));
+    EXPECT_EQ("*/*", structured_request.request_header.at("Accept"));
+    EXPECT_EQ("0", structured_request.entity_header.at("Content-Length"));
+    EXPECT_EQ("value", structured_request.extension_header.at("X-Custom"));
+    EXPECT_EQ(0u, structured_request.entity_header.count("X-Custom"));
+}
+
+TEST (http_request_view_test, header_identification) {
+    ///////////////////////////////////////////////////////
+    // Every header of the protocol is identified, in the order of its list, with the class of its list.
+    size_t id = 1;
+    for (const auto& headers : {std::make_pair(http_constants::GENERAL_HEADER, http_constants::header_class::general),
+                                std::make_pair(http_constants::REQUEST_HEADER, http_constants::header_class::request),
+                                std::make_pair(http_constants::ENTITY_HEADER, http_constants::header_class::entity)}) {
+        for (const std::string name : headers.first) {
+            const http_constants::header_id header = http_constants::find_header(name.data(), name.size());
+            EXPECT_EQ(id++, static_cast<size_t>(header)) << name;
+            EXPECT_EQ(headers.second, http_constants::get_header_class(header)) << name;
+        }
+    }
+
+    const std::string content_length = "content-LENGTH";
+    EXPECT_EQ(http_constants::header_id::content_length, http_constants::find_header(content_length.data(), content_length.size()));
+    EXPECT_EQ(http_constants::header_id::user_agent, http_constants::find_header("User-Agent", 10));
+
+    ///////////////////////////////////////////////////////
+    // Unknown headers, even those sharing a prefix with a known one, are extension headers.
+    for (const std::string name : {"X-Custom", "Hos", "Hosts", "Content-Lengthy", ""}) {
+        const http_constants::header_id header = http_constants::find_header(name.data(), name.size());
+        EXPECT_EQ(http_constants::header_id::unknown, header) << name;
+        EXPECT_EQ(http_constants::header_class::extension, http_constants::get_header_class(header)) << name;
+    }
+}
+
+TEST (http_request_view_test, connection_close) {
+    const auto request = std::make_shared<const std::string>("GET / HTTP/1.1\r\nConnection: Keep-Alive, Close\r\n\r\n");
+    EXPECT_FALSE(http_service::parse_request_view(request).keep_alive());
+}
+
+TEST (http_request_view_test, invalid_request_line) {
+    EXPECT_THROW(http_service::parse_request_view(std::make_shared<const std::string>("GET  / HTTP/1.1\r\n\r\n")), http_invalid_request);
+    EXPECT_THROW(http_service::parse_request_view(std::make_shared<const std::string>("FETCH / HTTP/1.1\r\n\r\n")), http_invalid_request);
+    EXPECT_THROW(http_service::parse_request_view(std::make_shared<const std::string>("GET / HTTP/2.0\r\n\r\n")), http_invalid_request);
+}
+
+TEST (http_request_view_test, request_line_identification) {
+    // Every method of the protocol is identified with its case, in the order of its list.
+    size_t index = 0;
+    for (const std::string name : http_constants::METHODS) {
+        http_constants::method m;
+        ASSERT_TRUE(http_constants::find_method(name.data(), name.size(), m)) << name;
+        EXPECT_EQ(index++, static_cast<size_t>(m)) << name;
+    }
+    http_constants::method m;
+    EXPECT_FALSE(http_constants::find_method("get", 3, m));
+    EXPECT_FALSE(http_constants::find_method("PATCH", 5, m));
+
+    EXPECT_EQ(http_constants::version::http_1_0, http_constants::find_version("HTTP/1.0", 8));
+    EXPECT_EQ(http_constants::version::http_1_1, http_constants::find_version("HTTP/1.1", 8));
+    EXPECT_EQ(http_constants::version::unknown, http_constants::find_version("HTTP/1.10", 9));
+    EXPECT_EQ(http_constants::version::unknown, http_constants::find_version("http/1.1", 8));
+
+    // The version is resolved as the request is parsed and carried with it.
+    const auto request = std::make_shared<const std::string>("DELETE /items/1 HTTP/1.1\r\n\r\n");
+    const http_request_view view = http_service::parse_request_view(request);
+    EXPECT_EQ(http_constants::method::m_delete, view.method);
+    EXPECT_EQ(http_constants::version::http_1_1, view.version);
+}
+
+TEST (http_request_view_test, request_uri) {
+    const http_request_uri absolute = http_request_uri::parse("http://example.com:8081/items/1?sort=name");
+    EXPECT_EQ(http_request_uri::form::absolute_uri, absolute.type);
+    EXPECT_EQ("example.com", absolute.host);
+    EXPECT_EQ("8081", absolute.port);
+    EXPECT_EQ("/items/1", absolute.abs_path);
+    EXPECT_EQ("sort=name", absolute.query);
+
+    const http_request_uri path = http_request_uri::parse("/items/1?");
+    EXPECT_EQ(http_request_uri::form::abs_path, path.type);
+    EXPECT_EQ("/items/1", path.abs_path);
+    EXPECT_TRUE(path.query.empty());
+
+    const http_request_uri authority = http_request_uri::parse("example.com:443");
+    EXPECT_EQ(http_request_uri::form::authority, authority.type);
+    EXPECT_EQ("443", authority.port);
+
+    EXPECT_EQ(http_request_uri::form::asterisk, http_request_uri::parse("*").type);
+    EXPECT_EQ(http_request_uri::form::invalid, http_request_uri::parse("items/1").type);
+    EXPECT_EQ(http_request_uri::form::invalid, http_request_uri::parse("http://example.com:65536/").type);
+    EXPECT_EQ(http_request_uri::form::invalid, http_request_uri::parse("http://:80/").type);
+
+    ///////////////////////////////////////////////////////
+    // The host of an absoluteURI takes precedence over the Host header (RFC2616 section 5.2).
+    const auto request = std::make_shared<const std::string>("GET http://example.com/ HTTP/1.1\r\nHost: localhost:8081\r\n\r\n");
+    const http_service::host host = http_service::extract_host(http_service::parse_request_view(request));
+    EXPECT_EQ("example.com", host.name);
+    EXPECT_EQ(80, host.port);
+
+    const auto invalid_host = std::make_shared<const std::string>("GET / HTTP/1.1\r\nHost: localhost:http\r\n\r\n");
+    EXPECT_THROW(http_service::extract_host(http_service::parse_request_view(invalid_host)), std::invalid_argument);
+}
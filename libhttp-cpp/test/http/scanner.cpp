@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "http_scanner.h"
+
+class http_scanner_test : public ::testing::TestWithParam<http_scanner::isa> {
+protected:
+    virtual void SetUp() {
+        previous_ = http_scanner::selected();
+        if (!http_scanner::select(GetParam()))
+            supported_ = false;
+    }
+
+    virtual void TearDown() {
+        http_scanner::select(previous_);
+    }
+
+    http_scanner::isa previous_;
+    bool supported_ = true;
+};
+
+TEST_P (http_scanner_test, every_position) {
+    if (!supported_)
+        return;
+
+    ///////////////////////////////////////////////////////
+    // The delimiter is found wherever it falls, in a block or in the bytes following the last one.
+    for (size_t length = 0; length <= 100; ++length) {
+        const std::string buffer(length, 'a');
+        const char* begin = buffer.data();
+        EXPECT_EQ(begin + length, http_scanner::find(begin, begin + length, '\n')) << "Length " << length << ".";
+
+        for (size_t position = 0; position < length; ++position) {
+            std::string line = buffer;
+            line[position] = ':';
+            if (position + 1 < length)
+                line[position + 1] = '\n';
+            EXPECT_EQ(line.data() + position, http_scanner::find_first_of(line.data(), line.data() + length, "\r\n:", 3))
+                << "Length " << length << ", position " << position << ".";
+        }
+    }
+}
+
+TEST_P (http_scanner_test, first_of_several) {
+    if (!supported_)
+        return;
+
+    const std::string line = "Accept-Language: en-US,en;q=0.9\r\nHost: localhost\r\n";
+    const char* end = line.data() + line.size();
+    EXPECT_EQ(line.find(':'), static_cast<size_t>(http_scanner::find_first_of(line.data(), end, "\n:", 2) - line.data()));
+    EXPECT_EQ(line.find('\r'), static_cast<size_t>(http_scanner::find_first_of(line.data(), end, "\r\n", 2) - line.data()));
+    EXPECT_EQ(line.find('\n', line.find('\n') + 1),
+              static_cast<size_t>(http_scanner::find(line.data() + line.find('\n') + 1, end, '\n') - line.data()));
+    EXPECT_EQ(end, http_scanner::find(line.data(), end, '\t'));
+}
+
+INSTANTIATE_TEST_CASE_P(instruction_sets, http_scanner_test,
+                        ::testing::Values(http_scanner::isa::scalar, http_scanner::isa::sse42, http_scanner::isa::avx2));
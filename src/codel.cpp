@@ -0,0 +1,52 @@
+#include "codel.h"
+
+#include <cmath>
+
+codel::codel(std::chrono::milliseconds target, std::chrono::milliseconds interval) noexcept :
+    target_(target), interval_(interval), dropping_(false), above_target_(false), count_(0), last_count_(0)
+{
+}
+
+bool codel::shed(clock::duration sojourn, clock::time_point now /* = clock::now() */) noexcept
+{
+    if (target_ == clock::duration::zero())
+        return false;
+
+    // A delay under the target ends any shedding, the queue is draining fast enough.
+    if (sojourn < target_) {
+        above_target_ = false;
+        dropping_ = false;
+        return false;
+    }
+
+    if (!above_target_) {
+        above_target_ = true;
+        first_above_time_ = now + interval_;
+        return false;
+    }
+
+    if (dropping_) {
+        if (now < drop_next_)
+            return false;
+        ++count_;
+        drop_next_ = next_drop(drop_next_);
+        return true;
+    }
+
+    if (now < first_above_time_)
+        return false;
+
+    // Resume close to the previous rate when the queue went back above the target shortly after.
+    dropping_ = true;
+    const uint32_t delta = count_ - last_count_;
+    count_ = (delta > 1 && now - drop_next_ < 16 * interval_) ? delta : 1;
+    last_count_ = count_;
+    drop_next_ = next_drop(now);
+    return true;
+}
+
+codel::clock::time_point codel::next_drop(clock::time_point from) const noexcept
+{
+    const double scale = 1.0 / std::sqrt(static_cast<double>(count_));
+    return from + std::chrono::duration_cast<clock::duration>(interval_ * scale);
+}
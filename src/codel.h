@@ -0,0 +1,44 @@
+#ifndef CODEL_H
+#define CODEL_H
+
+#include <chrono>
+#include <cstdint>
+
+/// \brief Controlled Delay (CoDel, RFC8289) decision of shedding a request, from the time it spent queued.
+///
+/// Shedding starts once the queuing delay stayed above the target for a whole interval, and then sheds
+/// a request more and more often, at intervals shrinking with the square root of the number of requests
+/// shed, until the delay goes back under the target. A burst shorter than the interval is never shed.
+class codel
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// \brief Constructor of the controller.
+    ///
+    /// \param target Acceptable queuing delay, 0 to never shed.
+    /// \param interval Time the delay must stay above the target before shedding.
+    codel(std::chrono::milliseconds target, std::chrono::milliseconds interval) noexcept;
+
+    /// \brief Decide the fate of a request leaving the queue.
+    ///
+    /// \param sojourn Time the request spent queued.
+    /// \param now The current time.
+    /// \returns True if the request must be shed.
+    bool shed(clock::duration sojourn, clock::time_point now = clock::now()) noexcept;
+
+private:
+    clock::time_point next_drop(clock::time_point from) const noexcept;
+
+    const clock::duration target_;
+    const clock::duration interval_;
+
+    bool              dropping_;
+    bool              above_target_;
+    clock::time_point first_above_time_;
+    clock::time_point drop_next_;
+    uint32_t          count_;
+    uint32_t          last_count_;
+};
+
+#endif
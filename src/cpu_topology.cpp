@@ -0,0 +1,84 @@
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <string>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+
+size_t ceil_ratio(long long quota, long long period)
+{
+    return static_cast<size_t>((quota + period - 1) / period);
+}
+
+}
+
+std::vector<int> cpu_topology::available_cpus()
+{
+    std::vector<int> cpus;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+        }
+    }
+
+    // Without an affinity mask, assume every core reported by the standard library is usable.
+    if (cpus.empty()) {
+        const int count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+size_t cpu_topology::usable_cpus()
+{
+    const size_t cpus = available_cpus().size();
+    const size_t quota = quota_cpus();
+    return (quota != 0) ? std::min(cpus, quota) : cpus;
+}
+
+bool cpu_topology::pin(std::thread::native_handle_type thread, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return ::pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+size_t cpu_topology::quota_cpus()
+{
+    // cgroup v2: "<quota> <period>", the quota being "max" when unlimited.
+    std::ifstream cpu_max("/sys/fs/cgroup/cpu.max");
+    if (cpu_max) {
+        std::string quota;
+        long long period = 0;
+        if (!(cpu_max >> quota >> period) || quota == "max" || period <= 0)
+            return 0;
+        try {
+            return ceil_ratio(std::stoll(quota), period);
+        } catch (std::exception&) {
+            return 0;
+        }
+    }
+
+    // cgroup v1: the quota is -1 when unlimited.
+    for (const std::string controller : {"/sys/fs/cgroup/cpu/", "/sys/fs/cgroup/cpu,cpuacct/"}) {
+        std::ifstream quota_file(controller + "cpu.cfs_quota_us");
+        std::ifstream period_file(controller + "cpu.cfs_period_us");
+        long long quota = 0;
+        long long period = 0;
+        if (quota_file >> quota && period_file >> period)
+            return (quota > 0 && period > 0) ? ceil_ratio(quota, period) : 0;
+    }
+    return 0;
+}
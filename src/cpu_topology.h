@@ -0,0 +1,31 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/// \brief Cores the server is allowed to run on, to size and place its threads.
+class cpu_topology
+{
+public:
+    /// \brief Cores of the affinity mask of the process, in ascending order.
+    static std::vector<int> available_cpus();
+
+    /// \brief Number of cores the process can keep busy: the cores of its affinity mask, capped by the
+    ///        CPU quota of its cgroup (cgroup v2 cpu.max or cgroup v1 cpu.cfs_quota_us), rounded up.
+    static size_t usable_cpus();
+
+    /// \brief Restrict a thread to a single core.
+    ///
+    /// \param thread The thread to pin.
+    /// \param cpu The core to run it on.
+    /// \returns False if the core is not available to the process.
+    static bool pin(std::thread::native_handle_type thread, int cpu);
+
+private:
+    /// \brief CPU quota of the cgroup of the process, in cores, or 0 without any quota.
+    static size_t quota_cpus();
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "http_admission.h"
+
+#include <strings.h>
+
+#include "http_structure.h"
+
+namespace
+{
+
+constexpr boost::string_view CRLF("\r\n", 2);
+
+// Look for the Host header among the header lines, up to the empty line ending them.
+bool find_host_header(boost::string_view header, boost::string_view& name, boost::string_view& digits) noexcept
+{
+    for (size_t begin = 0; begin < header.size(); ) {
+        begin += CRLF.size();
+        const size_t end = header.find(CRLF, begin);
+        if (end == boost::string_view::npos || end == begin)
+            return false;
+
+        boost::string_view line = header.substr(begin, end - begin);
+        if (line.size() > 5 && ::strncasecmp(line.data(), "host:", 5) == 0) {
+            line.remove_prefix(5);
+            while (!line.empty() && (line.front() == ' ' || line.front() == '\t'))
+                line.remove_prefix(1);
+            while (!line.empty() && (line.back() == ' ' || line.back() == '\t'))
+                line.remove_suffix(1);
+            return http_request_uri::parse_authority(line, name, digits);
+        }
+        begin = end;
+    }
+    return false;
+}
+
+}
+
+bool http_admission::counter::acquire() noexcept
+{
+    if (limit == 0)
+        return true;
+    if (in_flight.fetch_add(1, std::memory_order_relaxed) < limit)
+        return true;
+    in_flight.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+}
+
+void http_admission::counter::release() noexcept
+{
+    if (limit != 0)
+        in_flight.fetch_sub(1, std::memory_order_relaxed);
+}
+
+http_admission::http_admission(size_t max_in_flight) noexcept :
+    server_(max_in_flight)
+{
+}
+
+void http_admission::limit(const http_service::host& host, size_t max_in_flight)
+{
+    if (max_in_flight == 0 || website_indices_.count(host) != 0)
+        return;
+
+    websites_.emplace_back(max_in_flight);
+    website_indices_.emplace(host, static_cast<uint16_t>(websites_.size()));
+}
+
+bool http_admission::admit(const char* request, size_t length, transaction_t& transaction)
+{
+    transaction.admission = 0;
+
+    // Only the requests of the websites with a limit pay for finding their host.
+    boost::string_view name;
+    uint16_t port;
+    if (!website_indices_.empty() && find_host(boost::string_view(request, length), name, port)) {
+        const auto website_it = website_indices_.find(std::make_pair(port, name));
+        if (website_it != website_indices_.end()) {
+            if (!websites_[website_it->second - 1].acquire())
+                return false;
+            transaction.admission = website_it->second;
+        }
+    }
+
+    if (!server_.acquire()) {
+        if (transaction.admission != 0)
+            websites_[transaction.admission - 1].release();
+        transaction.admission = 0;
+        return false;
+    }
+    return true;
+}
+
+void http_admission::release(const transaction_t& transaction) noexcept
+{
+    server_.release();
+    if (transaction.admission != 0)
+        websites_[transaction.admission - 1].release();
+}
+
+bool http_admission::host_less::operator()(const http_service::host& lhs, const http_service::host& rhs) const noexcept
+{
+    return lhs < rhs;
+}
+
+bool http_admission::host_less::operator()(const http_service::host& lhs, const key& rhs) const noexcept
+{
+    return lhs.port < rhs.first || (lhs.port == rhs.first && boost::string_view(lhs.name) < rhs.second);
+}
+
+bool http_admission::host_less::operator()(const key& lhs, const http_service::host& rhs) const noexcept
+{
+    return lhs.first < rhs.port || (lhs.first == rhs.port && lhs.second < boost::string_view(rhs.name));
+}
+
+bool http_admission::find_host(boost::string_view request, boost::string_view& name, uint16_t& port) noexcept
+{
+    // The Request-URI is split the same way as by the protocol handlers.
+    const size_t line_end = request.find(CRLF);
+    if (line_end == boost::string_view::npos)
+        return false;
+    const boost::string_view request_line = request.substr(0, line_end);
+    const size_t uri_begin = request_line.find(' ');
+    const size_t uri_end = request_line.rfind(' ');
+    if (uri_begin == boost::string_view::npos || uri_end == uri_begin)
+        return false;
+    const boost::string_view request_uri = request_line.substr(uri_begin + 1, uri_end - uri_begin - 1);
+    const http_request_uri uri = http_request_uri::parse(request_uri);
+
+    boost::string_view digits;
+    switch (uri.type) {
+        case http_request_uri::form::absolute_uri:
+        case http_request_uri::form::authority:
+            // An absolute Request-URI takes precedence over the Host header (RFC2616 section 5.2).
+            name = uri.host;
+            digits = uri.port;
+            break;
+
+        case http_request_uri::form::abs_path:
+            if (!find_host_header(request.substr(line_end), name, digits))
+                return false;
+            break;
+
+        default:
+            return false;
+    }
+
+    // The authorities were checked as they were split, the port is valid.
+    http_request_uri::parse_port(digits, port);
+    return true;
+}
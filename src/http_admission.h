@@ -0,0 +1,91 @@
+#ifndef HTTP_ADMISSION_H
+#define HTTP_ADMISSION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <boost/utility/string_view.hpp>
+
+#include "http_service.h"
+#include "transaction.h"
+
+/// \brief Bound on the requests handed to the workers and not answered yet, for the whole server and per website.
+///
+/// The front-ends admit every request before dispatching it and release it when its response comes back.
+/// A request past one of the limits is answered right away with 503 Service Unavailable, without reaching
+/// a worker, so that an overloaded server sheds its load cheaply instead of letting its queues grow.
+/// The website of a request is found from its raw bytes, the same way as http_service::extract_host.
+class http_admission
+{
+public:
+    /// \brief Constructor of the admission control.
+    ///
+    /// \param max_in_flight Number of requests of the whole server in progress at the same time, 0 for no limit.
+    explicit http_admission(size_t max_in_flight) noexcept;
+
+    http_admission(const http_admission&) = delete;
+    http_admission& operator=(const http_admission&) = delete;
+
+    /// \brief Bound the requests of a website in progress at the same time.
+    /// \note Must be called before the front-ends are started.
+    ///
+    /// \param host The host of the website.
+    /// \param max_in_flight Number of requests in progress at the same time, 0 for no limit.
+    void limit(const http_service::host& host, size_t max_in_flight);
+
+    /// \brief Admit a request, unless the server or its website is at its limit.
+    /// \note Can be called from any front-end thread.
+    ///
+    /// \param request The complete request.
+    /// \param length The length of the request.
+    /// \param[in,out] transaction The envelope of the request, recording the website it was admitted on.
+    /// \returns False if the request must be shed.
+    bool admit(const char* request, size_t length, transaction_t& transaction);
+
+    /// \brief Release a request admitted earlier, once answered.
+    void release(const transaction_t& transaction) noexcept;
+
+private:
+    struct counter
+    {
+        const size_t limit;
+        std::atomic<size_t> in_flight;
+
+        explicit counter(size_t limit) noexcept : limit(limit), in_flight(0) {}
+
+        bool acquire() noexcept;
+        void release() noexcept;
+    };
+
+    // Order of the websites, also looked up by their port and a slice of a request naming them.
+    struct host_less
+    {
+        using is_transparent = void;
+        using key = std::pair<uint16_t, boost::string_view>;
+
+        bool operator()(const http_service::host& lhs, const http_service::host& rhs) const noexcept;
+        bool operator()(const http_service::host& lhs, const key& rhs) const noexcept;
+        bool operator()(const key& lhs, const http_service::host& rhs) const noexcept;
+    };
+
+    /// \brief Find the host of a request from its Request-URI, or from its Host header when it has none.
+    ///
+    /// \param request The complete request.
+    /// \param name Set to the host name, a slice of the request.
+    /// \param port Set to the port, 80 when absent.
+    /// \returns False if the request names no valid host.
+    static bool find_host(boost::string_view request, boost::string_view& name, uint16_t& port) noexcept;
+
+    counter server_;
+
+    // Counters of the websites with a limit, the admission of a transaction is their index plus one.
+    std::deque<counter> websites_;
+    std::map<http_service::host, uint16_t, host_less> website_indices_;
+};
+
+#endif
@@ -0,0 +1,363 @@
+#include "http_connection.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "http_structure.hpp"
+#include "response_stream.h"
+#include "zmq_utility.hpp"
+
+namespace
+{
+
+int open_spill_file(const std::string& directory)
+{
+    if (directory.empty())
+        return ::memfd_create("http-request-body", MFD_CLOEXEC);
+
+    // The file has no name, it is released along with its last descriptor.
+    const int fd = ::open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd >= 0 || (errno != EOPNOTSUPP && errno != EISDIR))
+        return fd;
+
+    // The file system does not support O_TMPFILE.
+    std::string path = directory + "/http-request-body-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    const int named_fd = ::mkostemp(name.data(), O_CLOEXEC);
+    if (named_fd >= 0)
+        ::unlink(name.data());
+    return named_fd;
+}
+
+}
+
+http_connection::http_connection(size_t max_request_body, clock::time_point now /* = clock::now() */) :
+    state_(state::idle), requests_(0), pending_(0), last_activity_(now), framer_(max_request_body), spilled_(0),
+    next_sequence_(0), next_release_(0), barrier_(false)
+{
+}
+
+bool http_connection::parallel(const char* request, size_t length) noexcept
+{
+    // Safe methods (RFC7231 section 4.2.1) have no effect another request could observe.
+    static const char* const methods[] = {"GET ", "HEAD ", "OPTIONS "};
+    for (const char* method : methods) {
+        const size_t method_length = std::strlen(method);
+        if (length >= method_length && std::memcmp(request, method, method_length) == 0)
+            return true;
+    }
+    return false;
+}
+
+transaction_t http_connection::dispatch(size_t max_requests, uint8_t flags /* = transaction_t::none */,
+                                        clock::time_point now /* = clock::now() */)
+{
+    transaction_t transaction;
+    transaction.sequence = next_sequence_++;
+    transaction.flags = static_cast<uint8_t>(flags & ~transaction_t::close);
+    transaction.admission = 0;
+    transaction.dispatched = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+    transaction.stream = 0;
+
+    ++requests_;
+    ++pending_;
+    last_activity_ = now;
+    started_.push_back((extracted_started_ != clock::time_point()) ? extracted_started_ : now);
+    extracted_started_ = clock::time_point();
+
+    if (state_ == state::closing || (max_requests != 0 && requests_ >= max_requests)) {
+        transaction.flags |= transaction_t::close;
+        state_ = state::closing;
+    } else {
+        state_ = state::processing;
+    }
+    return transaction;
+}
+
+bool http_connection::complete(const transaction_t& transaction, std::vector<zmq::message_t>&& parts,
+                               std::deque<frame>& output, clock::time_point now /* = clock::now() */)
+{
+    last_activity_ = now;
+
+    // The responses following the one closing the connection are discarded, and their streams stopped.
+    if (pending_ == 0) {
+        if (transaction.flags & transaction_t::partial)
+            response_stream::cancel(transaction);
+        return state_ != state::closing;
+    }
+    // The messages of a streamed response are gathered until it is released, then passed through as they come.
+    response& received = responses_[transaction.sequence];
+    received.flags = transaction.flags;
+    std::move(parts.begin(), parts.end(), std::back_inserter(received.parts));
+
+    // Release the responses in the order of the requests, holding back those which overtook an earlier one.
+    for (auto it = responses_.find(next_release_); it != responses_.end(); it = responses_.find(next_release_)) {
+        std::vector<zmq::message_t>& released = it->second.parts;
+        const bool file_body = (it->second.flags & transaction_t::file_body) != 0;
+        for (size_t i = 0; i < released.size(); ++i)
+            output.emplace_back(std::move(released[i]), file_body && i + 1 == released.size());
+
+        // A streamed response keeps its place until its last message, its progress holds its timeout back.
+        if (it->second.flags & transaction_t::partial) {
+            released.clear();
+            started_.front() = now;
+            break;
+        }
+
+        const bool close = (it->second.flags & transaction_t::close) != 0;
+        responses_.erase(it);
+        ++next_release_;
+        --pending_;
+        started_.pop_front();
+
+        if (close) {
+            state_ = state::closing;
+            pending_ = 0;
+            responses_.clear();
+            started_.clear();
+            input_.clear();
+            framer_.reset();
+            spill_.rebuild();
+            spilled_ = 0;
+            break;
+        }
+    }
+
+    if (pending_ == 0) {
+        barrier_ = false;
+        if (state_ == state::processing)
+            state_ = input_.empty() ? state::idle : state::reading;
+    }
+    return state_ != state::closing || pending_ > 0;
+}
+
+http_connection::clock::time_point http_connection::deadline(const http_server_options& options) const noexcept
+{
+    return next_timeout(options).second;
+}
+
+http_connection::timeout http_connection::expired(const http_server_options& options,
+                                                  clock::time_point now /* = clock::now() */) const noexcept
+{
+    const auto next = next_timeout(options);
+    return (now >= next.second) ? next.first : timeout::none;
+}
+
+std::pair<http_connection::timeout, http_connection::clock::time_point>
+http_connection::next_timeout(const http_server_options& options) const noexcept
+{
+    std::pair<timeout, clock::time_point> next(timeout::none, clock::time_point::max());
+    const auto consider = [&next](timeout kind, clock::time_point since, std::chrono::milliseconds duration) {
+        if (duration.count() > 0 && since + duration < next.second)
+            next = std::make_pair(kind, since + duration);
+    };
+
+    switch (state_) {
+        case state::idle:
+            consider(timeout::idle, last_activity_, options.keep_alive_timeout);
+            break;
+        case state::reading: {
+            // A client trickling its request is bounded both per stage and as a whole.
+            const clock::time_point started = (request_started_ != clock::time_point()) ? request_started_ : last_activity_;
+            if (body_started_ == clock::time_point())
+                consider(timeout::header, started, options.header_timeout);
+            else
+                consider(timeout::body, body_started_, options.body_timeout);
+            consider(timeout::request, started, options.request_timeout);
+            break;
+        }
+        case state::processing:
+        case state::closing:
+            // The responses are released in order, the oldest request bounds the others.
+            if (!started_.empty())
+                consider(timeout::request, started_.front(), options.request_timeout);
+            else
+                consider(timeout::idle, last_activity_, options.keep_alive_timeout);
+            break;
+    }
+    return next;
+}
+
+bool http_connection::input_full(const http_server_options& options) const noexcept
+{
+    // A longer message body leaves the buffer for a file as it arrives (see spill_body), or is refused.
+    size_t max_body = options.body_spill_threshold;
+    if (max_body == 0 || (options.max_request_body != 0 && options.max_request_body < max_body))
+        max_body = options.max_request_body;
+    if (max_body == 0)
+        return false;
+    return input_.size() > http_request_framer::MAX_HEADER_LENGTH + max_body;
+}
+
+bool http_connection::receive(const char* data, size_t length)
+{
+    if (state_ == state::closing)
+        return false;
+    last_activity_ = clock::now();
+
+    // Most requests fit in a single read: frame them in place and spare the receive buffer.
+    if (input_.empty() && pending_ == 0) {
+        const http_request_framer::status status = framer_.consume(data, length);
+        if (status == http_request_framer::status::complete && framer_.request_begin() == 0 &&
+            framer_.request_end() == length) {
+            framer_.reset();
+            barrier_ = !parallel(data, length);
+            extracted_started_ = last_activity_;
+            return true;
+        }
+    }
+
+    // The framer keeps its position, the buffer starts with the bytes it already scanned.
+    input_.append(data, length);
+    return false;
+}
+
+http_request_framer::status http_connection::extract_request(std::string& request, zmq::message_t& body,
+                                                             const http_server_options& options)
+{
+    if (state_ == state::closing || input_.empty())
+        return http_request_framer::status::incomplete;
+
+    // The engines append to the receive buffer directly, the request started with the first bytes seen.
+    if (request_started_ == clock::time_point())
+        request_started_ = clock::now();
+
+    // A large message body is moved out of the receive buffer as it arrives, whether the request waits or not.
+    if (!spill_body(options))
+        return http_request_framer::status::invalid;
+    if (barrier_ || (pending_ > 0 && pending_ >= options.max_pipelined_requests))
+        return http_request_framer::status::incomplete;
+
+    // The framer is done with a spilled request, only the bytes of its body are awaited.
+    const bool spilling = spill_.size() > 0;
+    http_request_framer::status status;
+    if (spilling)
+        status = (spilled_ == framer_.content_length()) ? http_request_framer::status::complete
+                                                        : http_request_framer::status::incomplete;
+    else
+        status = framer_.consume(input_.data(), input_.size());
+
+    if (status == http_request_framer::status::complete) {
+        const size_t begin = framer_.request_begin();
+        const size_t end = spilling ? framer_.header_end() : framer_.request_end();
+        const bool in_parallel = parallel(input_.data() + begin, end - begin);
+        if (pending_ > 0 && !in_parallel)
+            return http_request_framer::status::incomplete;
+
+        if (begin == 0 && end == input_.size()) {
+            request = std::move(input_);
+            input_.clear();
+        } else {
+            request.assign(input_, begin, end - begin);
+            input_.erase(0, end);
+        }
+        if (spilling) {
+            static_cast<file_frame_t*>(spill_.data())->length = spilled_;
+            body.move(&spill_);
+            spilled_ = 0;
+        }
+        framer_.reset();
+        barrier_ = !in_parallel;
+
+        // The bytes left belong to the next request, which already started.
+        extracted_started_ = request_started_;
+        request_started_ = input_.empty() ? clock::time_point() : clock::now();
+        body_started_ = clock::time_point();
+    } else if ((status == http_request_framer::status::invalid || status == http_request_framer::status::too_large) &&
+               pending_ > 0) {
+        // The error response must follow the responses to the requests preceding the invalid one.
+        return http_request_framer::status::incomplete;
+    } else if (status == http_request_framer::status::incomplete && pending_ == 0) {
+        state_ = state::reading;
+        if (framer_.header_complete() && body_started_ == clock::time_point())
+            body_started_ = clock::now();
+    }
+    return status;
+}
+
+bool http_connection::spill_body(const http_server_options& options)
+{
+    // 1. Open the file once the header announces a message body past the threshold.
+    if (spill_.size() == 0) {
+        if (options.body_spill_threshold == 0 ||
+            framer_.consume(input_.data(), input_.size()) == http_request_framer::status::invalid ||
+            !framer_.header_complete() || framer_.content_length() <= options.body_spill_threshold)
+            return true;
+
+        const int fd = open_spill_file(options.body_spill_directory);
+        if (fd < 0)
+            return false;
+        spill_ = make_zmq_file_message(fd, 0, 0);
+    }
+
+    // 2. Move the bytes of the body received so far to the file, the header stays in the buffer.
+    //    The file lives in the page cache, the write does not wait for a disk.
+    const int fd = static_cast<const file_frame_t*>(spill_.data())->fd;
+    const size_t header_end = framer_.header_end();
+    const size_t available = static_cast<size_t>(std::min<uint64_t>(input_.size() - header_end,
+                                                                     framer_.content_length() - spilled_));
+    size_t written = 0;
+    while (written < available) {
+        const ssize_t result = ::write(fd, input_.data() + header_end + written, available - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        written += static_cast<size_t>(result);
+    }
+    input_.erase(header_end, available);
+    spilled_ += available;
+    return true;
+}
+
+std::string http_connection::reject(http_constants::status code)
+{
+    state_ = state::closing;
+    input_.clear();
+    framer_.reset();
+    spill_.rebuild();
+    spilled_ = 0;
+    request_started_ = body_started_ = clock::time_point();
+
+    return error_response(code, true);
+}
+
+bool http_connection::shed(const transaction_t& transaction, std::chrono::seconds retry_after,
+                           std::deque<frame>& output, clock::time_point now /* = clock::now() */)
+{
+    // The response goes through the same ordering as those of the workers.
+    transaction_t response = transaction;
+    response.flags = static_cast<uint8_t>(transaction.flags & transaction_t::close);
+
+    std::vector<zmq::message_t> parts;
+    parts.push_back(make_zmq_message(error_response(http_constants::status::http_service_unavailable,
+                                                    (response.flags & transaction_t::close) != 0, retry_after)));
+    return complete(response, std::move(parts), output, now);
+}
+
+std::string http_connection::error_response(http_constants::status code, bool close,
+                                            std::chrono::seconds retry_after /* = std::chrono::seconds(0) */)
+{
+    http_response response;
+    response.status_code = code;
+    response.general_header["Connection"] = close ? "close" : "keep-alive";
+    response.general_header["Date"] = http_constants::http_date();
+    response.entity_header["Content-Length"] = "0";
+    if (retry_after.count() > 0)
+        response.response_header["Retry-After"] = std::to_string(retry_after.count());
+
+    std::ostringstream response_builder;
+    response_builder << response;
+    return response_builder.str();
+}
@@ -0,0 +1,202 @@
+#ifndef HTTP_CONNECTION_H
+#define HTTP_CONNECTION_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include "http_constants.h"
+#include "http_request_framer.h"
+#include "http_server_options.h"
+#include "transaction.h"
+
+/// \brief State machine of a client connection, shared by every front-end engine.
+///
+/// Tracks the persistence of the connection: how many requests it served, whether one is in progress
+/// and when it was last active, to enforce its timeouts and the requests-per-connection limit.
+/// It also reassembles the requests split across several reads in its receive buffer, splits the requests
+/// pipelined in a single read, and restores the order of their responses.
+class http_connection
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum class state : uint8_t {
+        idle,       ///< Waiting for a request, subject to the keep-alive timeout.
+        reading,    ///< Part of a request was received, waiting for the rest of it.
+        processing, ///< Requests were dispatched to the workers and are not all answered yet.
+        closing     ///< The connection is closed once the pending output is written.
+    };
+
+    /// \brief Timeouts of a connection, each enforced in some of the states.
+    enum class timeout : uint8_t {
+        none,
+        idle,    ///< Idle, or flushing its last response, past http_server_options::keep_alive_timeout.
+        header,  ///< Reading a request header past http_server_options::header_timeout.
+        body,    ///< Reading a request body past http_server_options::body_timeout.
+        request  ///< Reading or processing a request past http_server_options::request_timeout.
+    };
+
+    /// \brief Frame of the output of a connection.
+    struct frame
+    {
+        zmq::message_t message;
+        bool file; ///< The message is a file_frame_t, standing for the bytes of the file.
+
+        frame(zmq::message_t&& message, bool file = false) : message(std::move(message)), file(file) {}
+    };
+
+    /// \brief Constructor of a connection.
+    ///
+    /// \param max_request_body Length of a request body accepted, see http_server_options::max_request_body.
+    /// \param now Time the connection was opened.
+    explicit http_connection(size_t max_request_body, clock::time_point now = clock::now());
+
+    state current() const noexcept { return state_; }
+    size_t requests() const noexcept { return requests_; }
+    size_t pending() const noexcept { return pending_; }
+
+    /// \brief Receive buffer, holding the bytes received but not dispatched yet.
+    std::string& input() noexcept { return input_; }
+
+    /// \brief Check if the receive buffer holds as much as a connection may buffer: a request header and a message
+    ///        body kept in memory. The engines then stop receiving until requests are extracted from the buffer.
+    ///
+    /// \param options The settings of the server, for the length of the message bodies kept in memory.
+    /// \returns False while the buffer has room, always when the message bodies are all kept in memory without
+    ///          any limit on their length.
+    bool input_full(const http_server_options& options) const noexcept;
+
+    /// \brief Append received bytes to the receive buffer.
+    ///
+    /// \param data The received bytes.
+    /// \param length The number of received bytes.
+    /// \returns True if the bytes are exactly one complete request that can be dispatched right away: nothing
+    ///          was buffered and no request is in progress. The bytes are then not appended to the buffer.
+    bool receive(const char* data, size_t length);
+
+    /// \brief Extract the next complete request from the receive buffer.
+    /// \note Pipelined GET, HEAD and OPTIONS requests are processed in parallel. Any other method waits for
+    ///       the requests in progress and holds back the next ones until it is answered, keeping its effects
+    ///       ordered with the requests around it.
+    ///
+    /// \note A message body past http_server_options::body_spill_threshold leaves the receive buffer for a file
+    ///       as it arrives, even while its request waits, the request then only holds its header.
+    ///
+    /// \param request Set to the request when it is complete.
+    /// \param body Set to the file_frame_t of the message body of the request when it was spilled, left empty
+    ///             otherwise.
+    /// \param options The settings of the server, for the number of requests of the connection processed at
+    ///                the same time and the spill of the message bodies.
+    /// \returns The framing status of the request at the front of the buffer, incomplete while it must wait.
+    ///          A message body which cannot be spilled is invalid, one past http_server_options::max_request_body
+    ///          is too large.
+    http_request_framer::status extract_request(std::string& request, zmq::message_t& body,
+                                                const http_server_options& options);
+
+    /// \brief Give up on the connection after an invalid request.
+    ///
+    /// \param code The status of the error response.
+    /// \returns The error response to write before closing the connection.
+    std::string reject(http_constants::status code);
+
+    /// \brief Answer a dispatched request without a worker, as the server is overloaded.
+    /// \note The response keeps its place among the responses to the pipelined requests.
+    ///
+    /// \param transaction The envelope of the request.
+    /// \param retry_after Delay suggested to the client before its next attempt.
+    /// \param output Receives the frames of the responses ready to be written, in the order of the requests.
+    /// \param now Time of the response.
+    /// \returns True if the connection is kept open after writing the output.
+    bool shed(const transaction_t& transaction, std::chrono::seconds retry_after, std::deque<frame>& output,
+              clock::time_point now = clock::now());
+
+    /// \brief Build a response without message body.
+    ///
+    /// \param code The status of the response.
+    /// \param close True if the connection is closed after the response.
+    /// \param retry_after Value of the Retry-After header, none when zero.
+    static std::string error_response(http_constants::status code, bool close,
+                                      std::chrono::seconds retry_after = std::chrono::seconds(0));
+
+    /// \brief Register a request dispatched to the workers.
+    ///
+    /// \param max_requests Number of requests allowed on the connection, 0 for no limit.
+    /// \param flags The flags of the envelope describing the front-end, such as transaction_t::file_body.
+    /// \param now Time of the dispatch.
+    /// \returns The envelope of the request, numbered in the order of the connection and asking to close
+    ///          the connection when it is the last one allowed.
+    transaction_t dispatch(size_t max_requests, uint8_t flags = transaction_t::none,
+                           clock::time_point now = clock::now());
+
+    /// \brief Register the response of a worker, which may overtake the responses to earlier requests.
+    /// \note The messages of a streamed response are written as they come once the response is released.
+    ///
+    /// \param transaction The envelope sent back by the worker.
+    /// \param parts The frames of the response, the last one is a file_frame_t when the envelope says so.
+    /// \param output Receives the frames of the responses ready to be written, in the order of the requests.
+    /// \param now Time of the response.
+    /// \returns True if the connection is kept open after writing the output.
+    bool complete(const transaction_t& transaction, std::vector<zmq::message_t>&& parts,
+                  std::deque<frame>& output, clock::time_point now = clock::now());
+
+    /// \brief Time the next timeout of the connection expires, which changes with its state.
+    ///
+    /// \param options The timeouts of the server.
+    /// \returns The deadline, or clock::time_point::max() if the connection has no timeout.
+    clock::time_point deadline(const http_server_options& options) const noexcept;
+
+    /// \brief Check if the connection went past one of its timeouts.
+    ///
+    /// \param options The timeouts of the server.
+    /// \param now The current time.
+    /// \returns The earliest timeout passed, timeout::none if the connection is still in time.
+    timeout expired(const http_server_options& options, clock::time_point now = clock::now()) const noexcept;
+
+private:
+    struct response
+    {
+        uint8_t flags;
+        std::vector<zmq::message_t> parts;
+    };
+
+    static bool parallel(const char* request, size_t length) noexcept;
+
+    bool spill_body(const http_server_options& options);
+
+    std::pair<timeout, clock::time_point> next_timeout(const http_server_options& options) const noexcept;
+
+    state               state_;
+    size_t              requests_;
+    size_t              pending_;
+    clock::time_point   last_activity_;
+
+    std::string         input_;
+    http_request_framer framer_;
+
+    // File of the message body of the request at the front of the receive buffer while it is spilled, as a
+    // file_frame_t owning its descriptor, and number of bytes of the body written to it.
+    zmq::message_t      spill_;
+    uint64_t            spilled_;
+
+    // Arrival of the request at the front of the receive buffer and of the end of its header, or
+    // clock::time_point() while unknown, then arrival of the requests in progress.
+    clock::time_point   request_started_;
+    clock::time_point   body_started_;
+    clock::time_point   extracted_started_;
+    std::deque<clock::time_point> started_;
+
+    uint32_t            next_sequence_;
+    uint32_t            next_release_;
+    bool                barrier_;
+    std::map<uint32_t, response> responses_;
+};
+
+#endif
@@ -0,0 +1,484 @@
+#include "http_dispatcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#include "http_connection.h"
+#include "logger.h"
+
+namespace
+{
+
+bool more_frames(zmq::socket_t& socket)
+{
+    int more;
+    size_t more_size = sizeof(more);
+    socket.getsockopt(ZMQ_RCVMORE, &more, &more_size);
+    return more != 0;
+}
+
+// Skip the frames left of a message refused on the way.
+void discard(zmq::socket_t& socket)
+{
+    while (more_frames(socket)) {
+        zmq::message_t part;
+        socket.recv(&part);
+    }
+}
+
+}
+
+http_dispatcher::http_dispatcher(zmq::context_t& context, const std::string& endpoint, size_t workers,
+                                 const http_server_options& options, const std::string& remote_endpoint /* = "" */) :
+    mode_(options.dispatch_mode), max_depth_(std::max<size_t>(1, options.worker_queue_depth)),
+    capacity_(workers + (remote_endpoint.empty() ? 0 : options.max_remote_workers)), remote_(!remote_endpoint.empty()),
+    heartbeat_interval_(options.heartbeat_interval), heartbeat_liveness_(std::max<size_t>(1, options.heartbeat_liveness)),
+    request_timeout_(options.request_timeout),
+    socket_(context, (mode_ == http_server_options::dispatch::least_loaded) ? zmq::socket_type::router : zmq::socket_type::dealer),
+    slots_(new slot[capacity_]), announced_(0), next_slot_(0), next_node_(std::random_device()())
+{
+    // The remote workers are addressed by their identity, which only the least_loaded dispatch does.
+    if (remote_ && mode_ != http_server_options::dispatch::least_loaded)
+        throw std::invalid_argument("Remote workers require the least_loaded dispatch.");
+
+    try {
+        socket_.bind(endpoint);
+        if (remote_) {
+            // The remote workers have a socket of their own, for the dispatcher to know which ones to trust.
+            remote_socket_ = std::make_unique<zmq::socket_t>(context, zmq::socket_type::router);
+            remote_socket_->bind(remote_endpoint);
+            logger::log(logger::type::server)->info() << "Accepting remote workers on " << remote_endpoint << ".";
+        }
+    } catch (zmq::error_t& e) {
+        logger::log(logger::type::server)->error() << "Server error, cannot bind the HTTP worker request channel: ";
+        logger::log(logger::type::server)->error() << "Error " << zmq_errno() << ": " << e.what();
+        throw;
+    }
+}
+
+void http_dispatcher::connect(zmq::socket_t& socket, const std::string& endpoint, size_t worker,
+                              http_server_options::dispatch mode)
+{
+    if (mode != http_server_options::dispatch::least_loaded) {
+        socket.connect(endpoint);
+        return;
+    }
+
+    // The front-end addresses the worker by its identity, and only once the empty frame announced it.
+    const worker_identity identity = make_worker_identity(static_cast<uint32_t>(worker));
+    socket.setsockopt(ZMQ_IDENTITY, identity.data(), identity.size());
+    socket.connect(endpoint);
+    socket.send(nullptr, 0);
+}
+
+void http_dispatcher::heartbeat(zmq::socket_t& socket)
+{
+    // The heartbeat is the announcement itself, a front-end restarted in the meantime learns the worker again.
+    socket.send(nullptr, 0);
+}
+
+void http_dispatcher::leave(zmq::socket_t& socket)
+{
+    socket.send(nullptr, 0, ZMQ_SNDMORE);
+    socket.send(nullptr, 0);
+}
+
+void http_dispatcher::register_node(zmq::socket_t& socket)
+{
+    // The registrations of a front-end not reached yet are not queued without limit.
+    socket.send(nullptr, 0, ZMQ_DONTWAIT);
+}
+
+bool http_dispatcher::receive_node(zmq::socket_t& socket, uint32_t& node, long timeout)
+{
+    std::vector<zmq::pollitem_t> poll_items = {
+        zmq::pollitem_t{static_cast<void*>(socket), 0, ZMQ_POLLIN, 0}
+    };
+    zmq::poll(poll_items, timeout);
+    if (!(poll_items[0].revents & ZMQ_POLLIN))
+        return false;
+
+    uint32_t received;
+    const size_t size = socket.recv(&received, sizeof(received));
+    discard(socket);
+    if (size != sizeof(received))
+        return false;
+
+    node = received & WORKER_NODE;
+    return true;
+}
+
+void http_dispatcher::send(const identity_t& id, const transaction_t& transaction, zmq::message_t&& request,
+                           zmq::message_t&& body /* = zmq::message_t() */)
+{
+    if (mode_ != http_server_options::dispatch::least_loaded) {
+        socket_.send(&id.identity, id.length, ZMQ_SNDMORE);
+        socket_.send(&transaction, sizeof(transaction), ZMQ_SNDMORE);
+        if (transaction.flags & transaction_t::body_file) {
+            socket_.send(request, ZMQ_SNDMORE);
+            socket_.send(body);
+        } else {
+            socket_.send(request);
+        }
+        return;
+    }
+
+    // The requests keep their order while some wait, a request never overtakes an earlier one.
+    // A spilled message body stays in the files of the process, only a local worker can read it.
+    const bool local_only = (transaction.flags & transaction_t::body_file) != 0;
+    slot* worker = waiting_.empty() ? least_loaded(local_only) : nullptr;
+    if (worker == nullptr) {
+        waiting_.push_back(waiting_request{id, transaction, std::move(request), std::move(body)});
+        return;
+    }
+    forward(*worker, id, transaction, request, body);
+}
+
+bool http_dispatcher::receive(identity_t& id, transaction_t& transaction, std::vector<zmq::message_t>& parts)
+{
+    while (true) {
+        // 1. The requests lost with a remote worker are answered in its place.
+        if (!lost_.empty()) {
+            id = lost_.front().request.id;
+            transaction = lost_.front().request.transaction;
+            transaction.flags &= transaction_t::close;
+            parts.clear();
+            parts.push_back(make_zmq_message(http_connection::error_response(lost_.front().status,
+                                                                             (transaction.flags & transaction_t::close) != 0)));
+            lost_.pop_front();
+            return true;
+        }
+
+        // 2. Find the worker answering, and process its announcement if it is one.
+        //    Whether the worker is remote only depends on the socket its message arrived on.
+        slot* worker = nullptr;
+        zmq::socket_t* from = &socket_;
+        if (mode_ == http_server_options::dispatch::least_loaded) {
+            worker_identity identity;
+            size_t identity_size = socket_.recv(identity.data(), identity.size(), ZMQ_DONTWAIT);
+            if (identity_size == 0 && remote_socket_) {
+                from = remote_socket_.get();
+                identity_size = from->recv(identity.data(), identity.size(), ZMQ_DONTWAIT);
+            }
+            if (identity_size == 0)
+                return false;
+
+            // A worker node registers under the identity zmq generated, starting with a null byte.
+            if (from == remote_socket_.get() && identity_size == WORKER_IDENTITY_SIZE && identity[0] == 0) {
+                discard(*from);
+                assign_node(identity);
+                continue;
+            }
+
+            uint32_t identifier;
+            std::memcpy(&identifier, &identity[1], sizeof(identifier));
+            if (from == remote_socket_.get() &&
+                (identity_size != WORKER_IDENTITY_SIZE || identity[0] != 'w' || !(identifier & REMOTE_WORKER))) {
+                logger::log(logger::type::server)->warn() << "Message of a remote peer without a remote worker identifier dropped.";
+                discard(*from);
+                continue;
+            }
+
+            // The messages of a remote peer are not trusted to hold every frame of the envelope.
+            id.length = more_frames(*from) ? from->recv(&id.identity, id.identity.size()) : 0;
+            if (id.length == 0) {
+                // An empty frame announces the worker, or keeps it alive, a second one tells it leaves.
+                if (more_frames(*from)) {
+                    discard(*from);
+                    depart(identity);
+                } else {
+                    announce(identity);
+                }
+                continue;
+            }
+
+            worker = find_slot(identifier);
+            if (worker != nullptr)
+                worker->last_seen = std::chrono::steady_clock::now();
+        } else {
+            id.length = socket_.recv(&id.identity, id.identity.size(), ZMQ_DONTWAIT);
+            if (id.length == 0)
+                return false;
+        }
+
+        // 3. Extract the envelope and the full message, keeping the frames as they are.
+        const size_t transaction_size = more_frames(*from) ? from->recv(&transaction, sizeof(transaction)) : 0;
+
+        parts.clear();
+        while (more_frames(*from)) {
+            zmq::message_t part;
+            from->recv(&part);
+            if (part.size() > 0)
+                parts.push_back(std::move(part));
+        }
+
+        // 4. The response of a remote worker must answer one of its requests, and gets its envelope back.
+        if (from != &socket_) {
+            if (worker == nullptr || transaction_size != sizeof(transaction) || id.length > id.identity.size() ||
+                !restore_envelope(*worker, id, transaction, parts)) {
+                logger::log(logger::type::server)->warn() << "Unexpected response of a remote worker dropped.";
+                continue;
+            }
+            drain_waiting();
+            return true;
+        }
+
+        // 5. The worker has room for another request, once the last message of its response is in.
+        if (worker != nullptr && !(transaction.flags & transaction_t::partial)) {
+            worker->depth.fetch_sub(1, std::memory_order_relaxed);
+            drain_waiting();
+        }
+        return true;
+    }
+}
+
+std::vector<http_dispatcher::worker_load> http_dispatcher::queue_depths() const
+{
+    std::vector<worker_load> loads;
+    const size_t announced = announced_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < announced; ++i) {
+        if (slots_[i].active.load(std::memory_order_acquire))
+            loads.push_back(worker_load{slots_[i].worker.load(std::memory_order_relaxed), slots_[i].depth.load(std::memory_order_relaxed)});
+    }
+    return loads;
+}
+
+void http_dispatcher::expire_workers(std::chrono::steady_clock::time_point now /* = std::chrono::steady_clock::now() */)
+{
+    if (!remote_ || now < next_expiry_)
+        return;
+    next_expiry_ = now + heartbeat_interval_;
+
+    const size_t announced = announced_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < announced; ++i) {
+        slot& s = slots_[i];
+        const uint32_t identifier = s.worker.load(std::memory_order_relaxed);
+        if (!s.active.load(std::memory_order_relaxed) || !(identifier & REMOTE_WORKER))
+            continue;
+
+        // A worker processing a request only sends its heartbeats in between, it is given the time of the request.
+        std::chrono::milliseconds limit = heartbeat_interval_ * static_cast<std::chrono::milliseconds::rep>(heartbeat_liveness_);
+        const size_t depth = s.depth.load(std::memory_order_relaxed);
+        if (depth > 0) {
+            if (request_timeout_.count() == 0)
+                continue;
+            limit = std::max(limit, request_timeout_);
+        }
+
+        if (now - s.last_seen > limit) {
+            logger::log(logger::type::server)->warn() << "Remote worker #" << (identifier & ~REMOTE_WORKER) << " stopped sending its heartbeats, dropped with " << depth << " request(s) in progress.";
+            drop(s, http_constants::status::http_gateway_timeout);
+        }
+    }
+}
+
+http_dispatcher::worker_identity http_dispatcher::make_worker_identity(uint32_t worker)
+{
+    // zmq reserves the identities starting with a null byte.
+    worker_identity identity;
+    identity[0] = 'w';
+    std::memcpy(&identity[1], &worker, sizeof(worker));
+    return identity;
+}
+
+void http_dispatcher::announce(const worker_identity& identity)
+{
+    uint32_t identifier;
+    std::memcpy(&identifier, &identity[1], sizeof(identifier));
+    const auto now = std::chrono::steady_clock::now();
+
+    // 1. The heartbeat of a known worker only keeps it alive.
+    slot* known = find_slot(identifier);
+    if (known != nullptr) {
+        known->last_seen = now;
+        return;
+    }
+
+    // 2. A new worker takes the slot of a dropped one, or the next one.
+    const size_t announced = announced_.load(std::memory_order_relaxed);
+    slot* free_slot = nullptr;
+    for (size_t i = 0; i < announced && free_slot == nullptr; ++i) {
+        if (!slots_[i].active.load(std::memory_order_relaxed))
+            free_slot = &slots_[i];
+    }
+    if (free_slot == nullptr && announced == capacity_) {
+        logger::log(logger::type::server)->warn() << "Unexpected worker #" << identifier << " ignored, " << capacity_ << " worker(s) already announced.";
+        return;
+    }
+
+    slot& s = (free_slot != nullptr) ? *free_slot : slots_[announced];
+    s.worker.store(identifier, std::memory_order_relaxed);
+    s.depth.store(0, std::memory_order_relaxed);
+    s.outstanding.clear();
+    s.last_seen = now;
+    s.active.store(true, std::memory_order_release);
+    if (free_slot == nullptr)
+        announced_.store(announced + 1, std::memory_order_release);
+
+    if (identifier & REMOTE_WORKER)
+        logger::log(logger::type::server)->info() << "Remote worker #" << (identifier & ~REMOTE_WORKER) << " connected.";
+    else
+        logger::log(logger::type::server)->debug() << "Worker #" << identifier << " ready.";
+
+    drain_waiting();
+}
+
+void http_dispatcher::assign_node(const worker_identity& peer)
+{
+    // 1. Hand out the next identifier no connected remote worker carries. The counter starts at random, for
+    //    a front-end restarted while its nodes still run not to give their identifiers again.
+    const size_t announced = announced_.load(std::memory_order_relaxed);
+    const auto in_use = [this, announced](uint32_t node) {
+        for (size_t i = 0; i < announced; ++i) {
+            const uint32_t identifier = slots_[i].worker.load(std::memory_order_relaxed);
+            if (slots_[i].active.load(std::memory_order_relaxed) && (identifier & REMOTE_WORKER) &&
+                (identifier & WORKER_NODE) == node)
+                return true;
+        }
+        return false;
+    };
+
+    constexpr uint32_t shift = 16;
+    constexpr uint32_t nodes = (WORKER_NODE >> shift) + 1;
+    uint32_t node = 0;
+    size_t attempts = 0;
+    do {
+        node = (next_node_++ << shift) & WORKER_NODE;
+    } while (in_use(node) && ++attempts < nodes);
+    if (attempts == nodes) {
+        logger::log(logger::type::server)->warn() << "Worker node refused, every node identifier is in use.";
+        return;
+    }
+
+    // 2. The node leaves its registration once answered, the reply is lost if it is already gone.
+    remote_socket_->send(peer.data(), peer.size(), ZMQ_SNDMORE);
+    remote_socket_->send(&node, sizeof(node));
+    logger::log(logger::type::server)->info() << "Worker node #" << (node >> shift) << " registered.";
+}
+
+void http_dispatcher::depart(const worker_identity& identity)
+{
+    uint32_t identifier;
+    std::memcpy(&identifier, &identity[1], sizeof(identifier));
+
+    slot* leaving = find_slot(identifier);
+    if (leaving == nullptr)
+        return;
+    logger::log(logger::type::server)->info() << "Remote worker #" << (identifier & ~REMOTE_WORKER) << " left with "
+                                              << leaving->outstanding.size() << " request(s) in progress.";
+    drop(*leaving, http_constants::status::http_bad_gateway);
+}
+
+void http_dispatcher::drop(slot& worker, http_constants::status status)
+{
+    // The requests in progress are answered by the dispatcher, releasing their admission with their response.
+    for (const auto& request : worker.outstanding)
+        lost_.push_back(lost_request{request, status});
+    worker.outstanding.clear();
+    worker.depth.store(0, std::memory_order_relaxed);
+    worker.active.store(false, std::memory_order_release);
+}
+
+bool http_dispatcher::restore_envelope(slot& worker, const identity_t& id, transaction_t& transaction,
+                                       std::vector<zmq::message_t>& parts)
+{
+    const auto request_it = std::find_if(worker.outstanding.begin(), worker.outstanding.end(),
+                                         [&id, &transaction](const outstanding_request& request) {
+        return request.transaction.sequence == transaction.sequence && request.id == id;
+    });
+    if (request_it == worker.outstanding.end())
+        return false;
+
+    // Only the closing of the connection is taken from the worker: its files and streams are not those of the
+    // process, and the admission of the request is the one recorded as it was sent.
+    const bool refused = (transaction.flags & (transaction_t::file_body | transaction_t::partial)) != 0;
+    const uint8_t close = static_cast<uint8_t>((transaction.flags | request_it->transaction.flags) & transaction_t::close);
+    transaction = request_it->transaction;
+    transaction.flags = close;
+    transaction.stream = 0;
+    worker.outstanding.erase(request_it);
+    worker.depth.fetch_sub(1, std::memory_order_relaxed);
+
+    if (refused) {
+        logger::log(logger::type::server)->warn() << "Remote worker #" << (worker.worker.load(std::memory_order_relaxed) & ~REMOTE_WORKER)
+                                                  << " answered with a file or a stream, refused.";
+        parts.clear();
+        parts.push_back(make_zmq_message(http_connection::error_response(http_constants::status::http_bad_gateway, close != 0)));
+    }
+    return true;
+}
+
+http_dispatcher::slot* http_dispatcher::find_slot(uint32_t worker)
+{
+    const size_t announced = announced_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < announced; ++i) {
+        if (slots_[i].active.load(std::memory_order_relaxed) && slots_[i].worker.load(std::memory_order_relaxed) == worker)
+            return &slots_[i];
+    }
+    return nullptr;
+}
+
+http_dispatcher::slot* http_dispatcher::least_loaded(bool local_only)
+{
+    // Start after the last worker picked, so the idle workers take the requests in turn.
+    const size_t announced = announced_.load(std::memory_order_relaxed);
+    slot* best = nullptr;
+    size_t best_depth = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i < announced && best_depth > 0; ++i) {
+        const size_t index = (next_slot_ + i) % announced;
+        const slot& s = slots_[index];
+        if (!s.active.load(std::memory_order_relaxed) ||
+            (local_only && (s.worker.load(std::memory_order_relaxed) & REMOTE_WORKER)))
+            continue;
+
+        const size_t depth = s.depth.load(std::memory_order_relaxed);
+        if (depth < best_depth) {
+            best = &slots_[index];
+            best_depth = depth;
+            next_slot_ = index + 1;
+        }
+    }
+    return (best_depth < max_depth_) ? best : nullptr;
+}
+
+void http_dispatcher::forward(slot& worker, const identity_t& id, const transaction_t& transaction,
+                              zmq::message_t& request, zmq::message_t& body)
+{
+    const uint32_t identifier = worker.worker.load(std::memory_order_relaxed);
+    const worker_identity identity = make_worker_identity(identifier);
+    worker.depth.fetch_add(1, std::memory_order_relaxed);
+
+    // A remote worker is never offered to answer with a file, its response is matched against the request.
+    zmq::socket_t& to = (identifier & REMOTE_WORKER) ? *remote_socket_ : socket_;
+    transaction_t sent = transaction;
+    if (identifier & REMOTE_WORKER) {
+        sent.flags &= static_cast<uint8_t>(~transaction_t::file_body);
+        worker.outstanding.push_back(outstanding_request{id, transaction});
+    }
+
+    to.send(identity.data(), identity.size(), ZMQ_SNDMORE);
+    to.send(&id.identity, id.length, ZMQ_SNDMORE);
+    to.send(&sent, sizeof(sent), ZMQ_SNDMORE);
+    if (sent.flags & transaction_t::body_file) {
+        to.send(request, ZMQ_SNDMORE);
+        to.send(body);
+    } else {
+        to.send(request);
+    }
+}
+
+void http_dispatcher::drain_waiting()
+{
+    while (!waiting_.empty()) {
+        waiting_request& front = waiting_.front();
+        slot* worker = least_loaded((front.transaction.flags & transaction_t::body_file) != 0);
+        if (worker == nullptr)
+            return;
+
+        forward(*worker, front.id, front.transaction, front.request, front.body);
+        waiting_.pop_front();
+    }
+}
@@ -0,0 +1,207 @@
+#ifndef HTTP_DISPATCHER_H
+#define HTTP_DISPATCHER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include "http_constants.h"
+#include "http_server_options.h"
+#include "identity.h"
+#include "transaction.h"
+
+/// \brief Request channel between a front-end and the workers of its shard.
+///
+/// With the round_robin dispatch, the channel is a DEALER socket handing the requests to the workers in turn.
+/// With the least_loaded dispatch, it is a ROUTER socket following the load-balancing broker pattern: every
+/// worker announces itself once connected, and each request goes to the announced worker with the fewest
+/// requests in progress. Once every worker holds http_server_options::worker_queue_depth requests, the next
+/// ones wait in the dispatcher until a worker answers, so that a slow request only delays its own connection.
+///
+/// The messages exchanged with the workers keep the same envelope in both modes (identity frame, transaction,
+/// request or response), the frame addressing the worker is added and removed by the dispatcher.
+///
+/// With the least_loaded dispatch, the channel can also accept the workers of other processes over TCP, see
+/// http_server_options::remote_workers_endpoint. They connect to a socket of their own, only the identifiers
+/// carrying REMOTE_WORKER are accepted on it. Their node registers first, for the bits of WORKER_NODE which
+/// no other node of the front-end carries: zmq silently refuses a peer taking the identity of a connected one.
+/// They announce themselves again on every heartbeat, and are dropped once silent for too long or when they leave.
+/// The file descriptors and the memory of the front-end cannot cross the network: a remote worker never receives
+/// a spilled message body, and a response of a remote worker with a file or a streamed message body is refused.
+/// The dispatcher keeps the envelope of every request in progress on a remote worker, the response must
+/// match one and gets its envelope back, the requests of a dropped worker are answered by the dispatcher.
+class http_dispatcher
+{
+public:
+    /// \brief Bit set in the identifier of the workers of another process.
+    static constexpr uint32_t REMOTE_WORKER = 0x80000000u;
+
+    /// \brief Bits of the identifier of a remote worker naming its node, handed out by the front-end.
+    static constexpr uint32_t WORKER_NODE = 0x7fff0000u;
+
+    /// \brief Number of requests in progress of a worker.
+    struct worker_load
+    {
+        size_t worker;
+        size_t depth;
+    };
+
+    /// \brief Constructor of the dispatcher, binding the request channel.
+    ///
+    /// \param context The zmq context shared with the workers.
+    /// \param endpoint The inproc endpoint the workers connect to.
+    /// \param workers Number of workers connecting to the endpoint.
+    /// \param options Settings of the server, for the dispatch mode, the depth of the worker queues and the
+    ///                heartbeats of the remote workers.
+    /// \param remote_endpoint Endpoint the remote workers connect to, empty when the channel has none.
+    http_dispatcher(zmq::context_t& context, const std::string& endpoint, size_t workers,
+                    const http_server_options& options, const std::string& remote_endpoint = "");
+
+    http_dispatcher(const http_dispatcher&) = delete;
+    http_dispatcher& operator=(const http_dispatcher&) = delete;
+
+    /// \brief Connect the request socket of a worker to the front-end and announce it.
+    ///
+    /// \param socket The DEALER socket of the worker, not yet connected.
+    /// \param endpoint The inproc endpoint of the front-end.
+    /// \param worker Identifier of the worker, unique among the workers of the endpoint.
+    /// \param mode The dispatch mode of the front-end.
+    static void connect(zmq::socket_t& socket, const std::string& endpoint, size_t worker,
+                        http_server_options::dispatch mode);
+
+    /// \brief Announce a connected remote worker again, keeping it alive in the front-end.
+    static void heartbeat(zmq::socket_t& socket);
+
+    /// \brief Tell the front-end a remote worker leaves, no request is sent to it anymore.
+    static void leave(zmq::socket_t& socket);
+
+    /// \brief Ask the front-end for the identifier of a worker node, see receive_node.
+    ///
+    /// \param socket A DEALER socket connected to the remote endpoint of the front-end, without identity.
+    static void register_node(zmq::socket_t& socket);
+
+    /// \brief Receive the identifier of a worker node, unique among the nodes connected to the front-end.
+    ///
+    /// \param socket The socket the node registered with.
+    /// \param[out] node The bits of WORKER_NODE carried by the identifiers of the workers of the node.
+    /// \param timeout Longest wait for the identifier, in milliseconds.
+    /// \returns False if the identifier did not arrive in time.
+    static bool receive_node(zmq::socket_t& socket, uint32_t& node, long timeout);
+
+    /// \brief Drop the remote workers which stopped sending their heartbeats.
+    /// \note Called regularly by the front-end, the requests in progress of a dropped worker are answered
+    ///       with 504 Gateway Timeout, see lost_requests.
+    ///
+    /// \param now The current time.
+    void expire_workers(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    /// \brief Socket to poll for the responses of the local workers.
+    zmq::socket_t& socket() noexcept { return socket_; }
+
+    /// \brief Socket to poll for the responses of the remote workers, nullptr when the channel has none.
+    zmq::socket_t* remote_socket() noexcept { return remote_socket_.get(); }
+
+    /// \brief Check if the answers of the dispatcher to the requests lost with a remote worker wait to be
+    ///        received, without any socket to poll for them.
+    bool lost_requests() const noexcept { return !lost_.empty(); }
+
+    /// \brief Hand a request over to a worker, or keep it until one is available.
+    /// \note The file of a spilled message body follows the request, see transaction_t::body_file.
+    void send(const identity_t& id, const transaction_t& transaction, zmq::message_t&& request,
+              zmq::message_t&& body = zmq::message_t());
+
+    /// \brief Receive the next response of a worker, without blocking.
+    ///
+    /// The announcements of the workers are processed on the way, and the requests waiting for a worker
+    /// are dispatched as the workers become available. The requests lost with a remote worker are answered
+    /// first, with 502 Bad Gateway or 504 Gateway Timeout.
+    ///
+    /// \param[out] id The identity of the connection the response belongs to.
+    /// \param[out] transaction The envelope of the transaction.
+    /// \param[out] parts The non-empty frames of the response.
+    /// \returns False when no response is waiting.
+    bool receive(identity_t& id, transaction_t& transaction, std::vector<zmq::message_t>& parts);
+
+    /// \brief Number of requests in progress of each announced worker.
+    /// \note Can be called from any thread, the depths are only tracked with the least_loaded dispatch.
+    std::vector<worker_load> queue_depths() const;
+
+private:
+    static constexpr size_t WORKER_IDENTITY_SIZE = 1 + sizeof(uint32_t);
+    using worker_identity = std::array<uint8_t, WORKER_IDENTITY_SIZE>;
+
+    // Envelope of a request handed to a remote worker, as the front-end sent it.
+    struct outstanding_request
+    {
+        identity_t id;
+        transaction_t transaction;
+    };
+
+    struct slot
+    {
+        std::atomic<uint32_t> worker;
+        std::atomic<size_t> depth;
+        std::atomic<bool> active; ///< False once a remote worker is dropped, until the slot is reused.
+        std::chrono::steady_clock::time_point last_seen;
+        std::deque<outstanding_request> outstanding; ///< The requests in progress of a remote worker.
+    };
+
+    struct lost_request
+    {
+        outstanding_request request;
+        http_constants::status status;
+    };
+
+    struct waiting_request
+    {
+        identity_t id;
+        transaction_t transaction;
+        zmq::message_t request;
+        zmq::message_t body;
+    };
+
+    static worker_identity make_worker_identity(uint32_t worker);
+
+    bool receive_envelope(zmq::socket_t& socket, bool remote, slot*& worker, identity_t& id, transaction_t& transaction);
+    bool restore_envelope(slot& worker, const identity_t& id, transaction_t& transaction, std::vector<zmq::message_t>& parts);
+    void announce(const worker_identity& identity);
+    void assign_node(const worker_identity& peer);
+    void depart(const worker_identity& identity);
+    void drop(slot& worker, http_constants::status status);
+    slot* find_slot(uint32_t worker);
+    slot* least_loaded(bool local_only);
+    void forward(slot& worker, const identity_t& id, const transaction_t& transaction, zmq::message_t& request,
+                 zmq::message_t& body);
+    void drain_waiting();
+
+    const http_server_options::dispatch mode_;
+    const size_t max_depth_;
+    const size_t capacity_;
+    const bool remote_;
+    const std::chrono::milliseconds heartbeat_interval_;
+    const size_t heartbeat_liveness_;
+    const std::chrono::milliseconds request_timeout_;
+    std::chrono::steady_clock::time_point next_expiry_;
+
+    zmq::socket_t socket_;
+    std::unique_ptr<zmq::socket_t> remote_socket_;
+
+    // Workers in the order of their announcement, only written to by the front-end thread. The local workers
+    // are followed by the remote ones, whose slots are reused once they are dropped.
+    std::unique_ptr<slot[]> slots_;
+    std::atomic<size_t> announced_;
+    size_t next_slot_;
+    uint32_t next_node_;
+
+    std::deque<waiting_request> waiting_;
+    std::deque<lost_request> lost_;
+};
+
+#endif
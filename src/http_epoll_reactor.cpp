@@ -0,0 +1,208 @@
+#include "http_epoll_reactor.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "transaction.h"
+
+namespace
+{
+
+constexpr int MAX_EVENTS = 256;
+constexpr size_t READ_CHUNK_SIZE = 16 * 1024;
+
+}
+
+http_epoll_reactor::http_epoll_reactor(zmq::context_t& context, const std::string& worker_endpoint, size_t shard, size_t workers,
+                                       http_admission& admission, const http_server_options& options) :
+    http_reactor(context, worker_endpoint, shard, workers, admission, options), epoll_fd_(::epoll_create1(EPOLL_CLOEXEC)),
+    receive_buffer_(new char[READ_CHUNK_SIZE])
+{
+    if (epoll_fd_ < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot create the epoll instance");
+}
+
+http_epoll_reactor::~http_epoll_reactor()
+{
+    // Stop the event loop before releasing the descriptors it uses.
+    stop();
+    ::close(epoll_fd_);
+}
+
+void http_epoll_reactor::add_listener(int fd)
+{
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = fd;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot register the listening socket");
+}
+
+void http_epoll_reactor::remove_listener(int fd)
+{
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void http_epoll_reactor::process_events()
+{
+    std::array<epoll_event, MAX_EVENTS> events;
+    const int count = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), 0);
+    for (int i = 0; i < count; ++i) {
+        const int fd = events[i].data.fd;
+
+        if (is_listener(fd)) {
+            accept_connections(fd);
+            continue;
+        }
+
+        connection* c = find_connection(fd);
+        if (c == nullptr)
+            continue;
+
+        bool keep = true;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            keep = false;
+        }
+        if (keep && (events[i].events & EPOLLIN)) {
+            keep = read_connection(*c);
+            if (keep)
+                dispatch_requests(*c);
+        }
+        // Write when the socket drained its buffer, or to flush an error response and a closed peer.
+        if (keep && ((events[i].events & EPOLLOUT) || !c->output.empty() || c->peer_closed)) {
+            keep = write_connection(*c);
+        }
+        if (!keep)
+            close_connection(*c);
+    }
+}
+
+void http_epoll_reactor::accept_connections(int listener)
+{
+    // Edge-triggered: accept until the backlog is empty.
+    while (true) {
+        const int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                logger::log(logger::type::server)->warn() << "Cannot accept connection: " << std::strerror(errno);
+            return;
+        }
+
+        const int enable = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            logger::log(logger::type::server)->warn() << "Cannot register connection: " << std::strerror(errno);
+            ::close(fd);
+            continue;
+        }
+
+        open_connection(fd);
+    }
+}
+
+bool http_epoll_reactor::read_connection(connection& c)
+{
+    // Edge-triggered: drain the socket, unless the receive buffer fills up first. The connection then
+    // frames and spills what it received before resume_receive polls the socket again.
+    std::string& input = c.session.input();
+    while (!c.peer_closed) {
+        if (c.session.input_full(options_)) {
+            c.receive_paused = true;
+            break;
+        }
+
+        const ssize_t received = ::recv(c.fd, receive_buffer_.get(), READ_CHUNK_SIZE, 0);
+        if (received > 0) {
+            input.append(receive_buffer_.get(), static_cast<size_t>(received));
+            continue;
+        }
+        if (received == 0) {
+            c.peer_closed = true;
+            break;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        return false;
+    }
+
+    // A client may half-close after sending its request, keep the connection until it is answered.
+    return !c.peer_closed || c.session.pending() > 0 || !input.empty();
+}
+
+bool http_epoll_reactor::write_connection(connection& c)
+{
+    while (!c.output.empty()) {
+        http_connection::frame& front = c.output.front();
+
+        ssize_t sent;
+        size_t length;
+        if (front.file) {
+            // The file is sent straight from the page cache, without going through user space.
+            const file_frame_t& file = *static_cast<const file_frame_t*>(front.message.data());
+            off_t offset = static_cast<off_t>(file.offset + c.output_offset);
+            length = static_cast<size_t>(file.length);
+            sent = ::sendfile(c.fd, file.fd, &offset, length - c.output_offset);
+            // The file shrank since the response announced its length, the response cannot be completed.
+            if (sent == 0)
+                return false;
+        } else {
+            // Hold the segment back when a file follows, so the header leaves along with the beginning of the body.
+            const int more = (c.output.size() > 1 && c.output[1].file) ? MSG_MORE : 0;
+            const char* data = static_cast<const char*>(front.message.data()) + c.output_offset;
+            length = front.message.size();
+            sent = ::send(c.fd, data, length - c.output_offset, MSG_NOSIGNAL | more);
+        }
+
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            // The socket buffer is full, EPOLLOUT will resume the write.
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            return false;
+        }
+
+        c.output_offset += static_cast<size_t>(sent);
+        if (c.output_offset == length) {
+            c.output.pop_front();
+            c.output_offset = 0;
+        }
+    }
+
+    return keep_after_write(c);
+}
+
+void http_epoll_reactor::resume_receive(connection& c)
+{
+    // Modifying the registration polls the socket again, the bytes left unread raise a new edge.
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = c.fd;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &event);
+}
+
+void http_epoll_reactor::close_connection(connection& c)
+{
+    const int fd = c.fd;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    erase_connection(c);
+}
@@ -0,0 +1,44 @@
+#ifndef HTTP_EPOLL_REACTOR_H
+#define HTTP_EPOLL_REACTOR_H
+
+#include <memory>
+#include <string>
+
+#include <zmq.hpp>
+
+#include "http_reactor.h"
+#include "http_server_options.h"
+
+/// \brief Reactor engine built on an edge-triggered epoll set.
+///
+/// The sockets are read and written with one system call per operation as soon as they are ready.
+class http_epoll_reactor : public http_reactor
+{
+public:
+    /// \brief Constructor of the reactor.
+    /// \see http_reactor::http_reactor
+    http_epoll_reactor(zmq::context_t& context, const std::string& worker_endpoint, size_t shard, size_t workers,
+                       http_admission& admission, const http_server_options& options);
+    ~http_epoll_reactor();
+
+protected:
+    const char* engine_name() const noexcept override { return "epoll"; }
+    int event_descriptor() const noexcept override { return epoll_fd_; }
+    void add_listener(int fd) override;
+    void remove_listener(int fd) override;
+    void process_events() override;
+    bool write_connection(connection& c) override;
+    void close_connection(connection& c) override;
+    void resume_receive(connection& c) override;
+
+private:
+    void accept_connections(int listener);
+    bool read_connection(connection& c);
+
+    int epoll_fd_;
+
+    // Bytes of the last receive, appended to the receive buffer of the connection.
+    std::unique_ptr<char[]> receive_buffer_;
+};
+
+#endif
@@ -0,0 +1,392 @@
+#include "http_reactor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "http_worker.h"
+#include "logger.h"
+#include "response_stream.h"
+#include "transaction.h"
+#include "zmq_utility.hpp"
+
+namespace
+{
+
+constexpr long POLL_TIMEOUT_MS = 100;
+constexpr int LISTEN_BACKLOG = 1024;
+
+}
+
+http_reactor::http_reactor(zmq::context_t& context, const std::string& worker_endpoint, size_t shard, size_t workers,
+                           http_admission& admission, const http_server_options& options) :
+    shard_(shard), options_(options),
+    dispatcher_(context, worker_endpoint, workers, options, (shard == 0) ? options.remote_workers_endpoint : std::string()),
+    admission_(admission),
+    websites_(nullptr), generation_(0), drain_requested_(false), draining_(false)
+{
+}
+
+http_reactor::~http_reactor()
+{
+    // The engines stop the event loop in their own destructor, before releasing what it uses.
+    stop();
+
+    for (auto& c : connections_)
+        ::close(c.first);
+    for (const auto& listener : listeners_)
+        ::close(listener.second);
+}
+
+void http_reactor::listen(uint16_t port)
+{
+    const auto listener_it = std::find_if(listeners_.cbegin(), listeners_.cend(),
+                                          [port](const std::pair<uint16_t, int>& l) { return l.first == port; });
+    if (listener_it != listeners_.cend())
+        return;
+
+    const bool reuse_port = options_.shards > 1 || !options_.handoff_path.empty();
+    adopt(port, open_listener(port, reuse_port));
+}
+
+int http_reactor::open_listener(uint16_t port, bool reuse_port)
+{
+    const int fd = ::socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot create the listening socket");
+
+    const int enable = 1;
+    const int disable = 0;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &disable, sizeof(disable));
+    if (reuse_port && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::system_category(), "Cannot enable SO_REUSEPORT");
+    }
+
+    sockaddr_in6 address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(port);
+
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, LISTEN_BACKLOG) < 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::system_category(), "Cannot listen on port " + std::to_string(port));
+    }
+
+    return fd;
+}
+
+void http_reactor::adopt(uint16_t port, int fd)
+{
+    try {
+        add_listener(fd);
+    } catch (std::exception&) {
+        ::close(fd);
+        throw;
+    }
+
+    listeners_.emplace_back(port, fd);
+}
+
+void http_reactor::run_to_completion(const std::set<http_website>& websites)
+{
+    websites_ = &websites;
+}
+
+void http_reactor::drain(http_connection::clock::time_point deadline) noexcept
+{
+    drain_deadline_ = deadline;
+    drain_requested_.store(true, std::memory_order_release);
+}
+
+void http_reactor::run()
+{
+    logger::log(logger::type::server)->info() << "Reactor #" << shard_ << " (" << engine_name() << ") online, listening on " << listeners_.size() << " port(s).";
+
+    // The engine exposes its events through a file descriptor, which lets a single zmq::poll wait
+    // on both the clients and the workers.
+    std::vector<zmq::pollitem_t> poll_items = {
+        zmq::pollitem_t{nullptr, event_descriptor(), ZMQ_POLLIN, 0},
+        zmq::pollitem_t{static_cast<void*>(dispatcher_.socket()), 0, ZMQ_POLLIN, 0}
+    };
+    if (dispatcher_.remote_socket() != nullptr)
+        poll_items.push_back(zmq::pollitem_t{static_cast<void*>(*dispatcher_.remote_socket()), 0, ZMQ_POLLIN, 0});
+
+    while (running) {
+        try {
+            flush();
+            zmq::poll(poll_items, POLL_TIMEOUT_MS);
+
+            if (poll_items[0].revents & ZMQ_POLLIN) {
+                process_events();
+            }
+
+            if ((poll_items[1].revents & ZMQ_POLLIN) || (poll_items.size() > 2 && (poll_items[2].revents & ZMQ_POLLIN))) {
+                forward_response();
+            }
+
+            // Only the connections past their deadline are visited.
+            // The requests of the remote workers dropped on the way are answered by the dispatcher.
+            const auto now = http_connection::clock::now();
+            timers_.advance(now, [this, now](connection& c) { expire_connection(c, now); });
+            dispatcher_.expire_workers(now);
+            if (dispatcher_.lost_requests())
+                forward_response();
+
+            if (drain_requested_.load(std::memory_order_acquire)) {
+                if (!draining_)
+                    start_drain();
+                if (connections_.empty()) {
+                    running = false;
+                } else if (now >= drain_deadline_) {
+                    logger::log(logger::type::server)->warn() << "Reactor #" << shard_ << " drain deadline reached, closing " << connections_.size() << " connection(s).";
+                    running = false;
+                }
+            }
+        } catch (zmq::error_t& e) {
+            logger::log(logger::type::server)->error() << "Server error, reactor #" << shard_ << " failed due to the following zmq exception: ";
+            logger::log(logger::type::server)->error() << "Error " << zmq_errno() << ": " << e.what();
+        }
+    }
+
+    logger::log(logger::type::server)->info() << "Reactor #" << shard_ << " shut down.";
+}
+
+http_reactor::connection& http_reactor::open_connection(int fd)
+{
+    connections_.erase(fd);
+    connection& c = connections_.emplace(std::piecewise_construct, std::forward_as_tuple(fd),
+                                         std::forward_as_tuple(fd, ++generation_, options_.max_request_body)).first->second;
+    schedule_timeout(c);
+    return c;
+}
+
+void http_reactor::erase_connection(connection& c)
+{
+    connections_.erase(c.fd);
+}
+
+http_reactor::connection* http_reactor::find_connection(int fd)
+{
+    const auto it = connections_.find(fd);
+    return (it != connections_.end()) ? &it->second : nullptr;
+}
+
+bool http_reactor::is_listener(int fd) const
+{
+    return std::any_of(listeners_.cbegin(), listeners_.cend(),
+                       [fd](const std::pair<uint16_t, int>& l) { return l.second == fd; });
+}
+
+bool http_reactor::writing(const connection& c) const
+{
+    return !c.output.empty();
+}
+
+bool http_reactor::keep_after_write(const connection& c) const noexcept
+{
+    // The output is flushed: wait for the pending responses, then either close or wait for the next request.
+    // A draining reactor closes the connection after its last response instead, unless a request is arriving.
+    if (c.session.pending() > 0)
+        return true;
+    if (draining_ && c.session.current() == http_connection::state::idle)
+        return false;
+    return c.session.current() != http_connection::state::closing && !c.peer_closed;
+}
+
+void http_reactor::dispatch_requests(connection& c)
+{
+    // Only complete requests reach the workers, a partial one waits in the receive buffer for more bytes.
+    // Pipelined requests are all dispatched at once, up to the limit of the connection.
+    std::string request;
+    bool extracting = true;
+    while (extracting) {
+        zmq::message_t body;
+        switch (c.session.extract_request(request, body, options_)) {
+            case http_request_framer::status::complete:
+                forward_request(c, std::move(request), std::move(body));
+                break;
+            case http_request_framer::status::invalid:
+                logger::log(logger::type::server)->warn() << "Invalid request framing on connection #" << c.fd << ", closing it.";
+                c.output.emplace_back(make_zmq_message(c.session.reject(http_constants::status::http_bad_request)));
+                extracting = false;
+                break;
+            case http_request_framer::status::too_large:
+                logger::log(logger::type::server)->warn() << "Request body too large on connection #" << c.fd << ", closing it.";
+                c.output.emplace_back(make_zmq_message(c.session.reject(http_constants::status::http_request_entry_too_large)));
+                extracting = false;
+                break;
+            case http_request_framer::status::incomplete:
+            default:
+                extracting = false;
+                break;
+        }
+    }
+
+    // The requests extracted or their bodies spilled made room in the receive buffer.
+    if (c.receive_paused && !c.session.input_full(options_)) {
+        c.receive_paused = false;
+        resume_receive(c);
+    }
+
+    // The state of the connection moved, and its deadline along with it.
+    schedule_timeout(c);
+}
+
+void http_reactor::forward_request(connection& c, std::string&& request, zmq::message_t&& body)
+{
+    const identity_t id = make_identity(c);
+    // The engines write the message bodies left in a file by the workers themselves.
+    // A draining reactor asks the client to close the connection with its response.
+    const size_t max_requests = draining_ ? 1 : options_.max_keep_alive_requests;
+    transaction_t transaction = c.session.dispatch(max_requests, transaction_t::file_body);
+    if (body.size() > 0)
+        transaction.flags |= transaction_t::body_file;
+
+    if (websites_ != nullptr) {
+        process_request(c, transaction, std::move(request), body);
+        return;
+    }
+
+    // Past the limits, the request is answered right away in the place of its response.
+    if (!admission_.admit(request.data(), request.size(), transaction)) {
+        c.session.shed(transaction, options_.retry_after, c.output);
+        return;
+    }
+
+    // The request is handed over to the message without any copy.
+    dispatcher_.send(id, transaction, make_zmq_message(std::move(request)), std::move(body));
+}
+
+void http_reactor::forward_response()
+{
+    // 1. Extract the identity frame of the connection, the envelope and the frames of the response.
+    identity_t id;
+    transaction_t transaction;
+    std::vector<zmq::message_t> parts;
+    while (dispatcher_.receive(id, transaction, parts)) {
+        // A streamed response is only answered with its last message.
+        if (!(transaction.flags & transaction_t::partial))
+            admission_.release(transaction);
+
+        // 2. Queue the response on the connection, unless it was closed in the meantime.
+        //    Responses overtaking an earlier request of the connection are held back until it is answered.
+        int fd;
+        uint32_t generation;
+        assert(id.length == sizeof(fd) + sizeof(generation));
+        std::memcpy(&fd, &id.identity[0], sizeof(fd));
+        std::memcpy(&generation, &id.identity[sizeof(fd)], sizeof(generation));
+
+        connection* c = find_connection(fd);
+        if (c == nullptr || c->generation != generation) {
+            if (transaction.flags & transaction_t::partial)
+                response_stream::cancel(transaction);
+            continue;
+        }
+
+        if (c->session.complete(transaction, std::move(parts), c->output))
+            dispatch_requests(*c);
+        else
+            schedule_timeout(*c);
+
+        if (!write_connection(*c))
+            close_connection(*c);
+    }
+}
+
+void http_reactor::process_request(connection& c, const transaction_t& transaction, std::string&& request,
+                                   const zmq::message_t& body)
+{
+    // The response is queued right away, the caller writes it once the buffered requests are all processed.
+    // The connection is closed by the write if the response asked for it.
+    transaction_t response_transaction = transaction;
+    const file_frame_t* body_file = (body.size() > 0) ? static_cast<const file_frame_t*>(body.data()) : nullptr;
+    std::vector<zmq::message_t> parts = http_worker::process(*websites_, shard_, response_transaction, std::move(request),
+                                                             body_file);
+    c.session.complete(response_transaction, std::move(parts), c.output);
+}
+
+void http_reactor::schedule_timeout(connection& c)
+{
+    timers_.schedule(c.timer, c.session.deadline(options_));
+}
+
+void http_reactor::expire_connection(connection& c, http_connection::clock::time_point now)
+{
+    // Writing a response is not limited in time, the connection is checked again later.
+    if (writing(c)) {
+        timers_.schedule(c.timer, now + options_.keep_alive_timeout);
+        return;
+    }
+
+    switch (c.session.expired(options_, now)) {
+        case http_connection::timeout::none:
+            // The deadline moved since the timer was scheduled.
+            schedule_timeout(c);
+            return;
+        case http_connection::timeout::idle:
+            close_connection(c);
+            return;
+        case http_connection::timeout::request:
+            // The workers did not answer in time, their responses can no longer be sent in order.
+            if (c.session.pending() > 0) {
+                logger::log(logger::type::server)->warn() << "Request timeout on connection #" << c.fd << ", closing it.";
+                close_connection(c);
+                return;
+            }
+            // fall through
+        case http_connection::timeout::header:
+        case http_connection::timeout::body:
+            logger::log(logger::type::server)->debug() << "Request not received in time on connection #" << c.fd << ", closing it.";
+            c.output.emplace_back(make_zmq_message(c.session.reject(http_constants::status::http_request_timeout)));
+            schedule_timeout(c);
+            if (!write_connection(c))
+                close_connection(c);
+            return;
+    }
+}
+
+void http_reactor::start_drain()
+{
+    logger::log(logger::type::server)->info() << "Reactor #" << shard_ << " draining " << connections_.size() << " connection(s).";
+    draining_ = true;
+
+    // 1. Stop accepting connections, the clients still connecting are refused.
+    for (const auto& listener : listeners_) {
+        remove_listener(listener.second);
+        ::close(listener.second);
+    }
+    listeners_.clear();
+
+    // 2. Close the connections waiting for their next request, the others are closed after their last response.
+    std::vector<connection*> idle;
+    for (auto& entry : connections_) {
+        connection& c = entry.second;
+        if (c.session.current() == http_connection::state::idle && c.session.pending() == 0 && !writing(c))
+            idle.push_back(&c);
+    }
+    for (connection* c : idle)
+        close_connection(*c);
+}
+
+identity_t http_reactor::make_identity(const connection& c)
+{
+    // The generation makes sure a late response is never written to a recycled file descriptor.
+    identity_t id;
+    std::memcpy(&id.identity[0], &c.fd, sizeof(c.fd));
+    std::memcpy(&id.identity[sizeof(c.fd)], &c.generation, sizeof(c.generation));
+    id.length = sizeof(c.fd) + sizeof(c.generation);
+    return id;
+}
@@ -0,0 +1,198 @@
+#ifndef HTTP_REACTOR_H
+#define HTTP_REACTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include "http_admission.h"
+#include "http_connection.h"
+#include "http_dispatcher.h"
+#include "http_server_options.h"
+#include "http_website.h"
+#include "identity.h"
+#include "runnable.h"
+#include "timer_wheel.hpp"
+
+/// \brief Native front-end of the server, replacing the ZMQ_STREAM proxy.
+///
+/// The reactor owns the listening sockets and every client connection, and hands the requests to the workers
+/// through an inproc http_dispatcher using the same envelope as the ZMQ_STREAM proxy (identity frame, transaction,
+/// request). The engines only differ by the way they move bytes between the sockets and the connections,
+/// which is left to the derived classes. The timeouts of every connection are kept in a timer wheel.
+class http_reactor : public class_thread
+{
+public:
+    /// \brief Constructor of the reactor.
+    ///
+    /// \param context The zmq context shared with the workers.
+    /// \param worker_endpoint The inproc endpoint the workers of this reactor connect to.
+    /// \param shard Index of the reactor among the reactors sharing the same ports.
+    /// \param workers Number of workers connecting to the endpoint.
+    /// \param admission Bound on the requests in progress, shared by the front-ends of the server.
+    /// \param options Settings of the server. When several shards are requested, the listening sockets are
+    ///                bound with SO_REUSEPORT so the kernel balances the incoming connections between them,
+    ///                and so are they when they may be handed over to a process with more shards.
+    http_reactor(zmq::context_t& context, const std::string& worker_endpoint, size_t shard, size_t workers,
+                 http_admission& admission, const http_server_options& options);
+    virtual ~http_reactor();
+
+    http_reactor(const http_reactor&) = delete;
+    http_reactor& operator=(const http_reactor&) = delete;
+
+    /// \brief Start listening for connections on a port.
+    /// \note Listening twice on the same port is a no-op.
+    ///
+    /// \param port The TCP port to bind on every interface.
+    void listen(uint16_t port);
+
+    /// \brief Open a non-blocking socket listening on a port, on every interface.
+    ///
+    /// \param port The TCP port to bind.
+    /// \param reuse_port True to join the SO_REUSEPORT group of the port, balanced by the kernel.
+    /// \returns The listening socket, owned by the caller.
+    /// \throws std::system_error if the port cannot be bound.
+    static int open_listener(uint16_t port, bool reuse_port);
+
+    /// \brief Start accepting the connections of a listening socket inherited from a previous process.
+    /// \note The reactor owns the socket, even when it throws.
+    ///
+    /// \param port The TCP port the socket is bound to.
+    /// \param fd The listening socket.
+    void adopt(uint16_t port, int fd);
+
+    /// \brief Listening sockets of the reactor with their port, to hand them over to the next process.
+    /// \note Can be called from any thread, until the reactor drains.
+    std::vector<std::pair<uint16_t, int>> listeners() const { return listeners_; }
+
+    /// \brief Process the requests on the reactor thread instead of handing them to the workers.
+    /// \note Must be called before the reactor is started.
+    ///
+    /// \param websites The websites served, which must outlive the reactor.
+    void run_to_completion(const std::set<http_website>& websites);
+
+    /// \brief Drain the reactor: stop accepting connections, close the idle ones and finish the requests in
+    ///        progress, then stop the event loop once every connection is closed.
+    /// \note Can be called from any thread, once.
+    ///
+    /// \param deadline Time the event loop stops at the latest, closing the connections left.
+    void drain(http_connection::clock::time_point deadline) noexcept;
+
+    /// \brief Request channel of the reactor, for the load of its workers.
+    const http_dispatcher& dispatcher() const noexcept { return dispatcher_; }
+
+protected:
+    struct connection;
+
+    void run() override;
+
+    /// \brief Name of the engine, for the logs.
+    virtual const char* engine_name() const noexcept = 0;
+
+    /// \brief File descriptor becoming readable when the engine has events to process.
+    virtual int event_descriptor() const noexcept = 0;
+
+    /// \brief Start accepting the connections of a new listening socket.
+    virtual void add_listener(int fd) = 0;
+
+    /// \brief Stop accepting the connections of a listening socket, before it is closed.
+    virtual void remove_listener(int fd) = 0;
+
+    /// \brief Process the events of the clients, without blocking.
+    virtual void process_events() = 0;
+
+    /// \brief Hand the operations queued during the iteration to the kernel before waiting for events.
+    virtual void flush() {}
+
+    /// \brief Write the output of a connection, or schedule it.
+    /// \returns False if the connection must be closed.
+    virtual bool write_connection(connection& c) = 0;
+
+    /// \brief Close a connection and forget it.
+    virtual void close_connection(connection& c) = 0;
+
+    /// \brief Receive again on a connection which stopped once its receive buffer was full, see
+    ///        http_connection::input_full.
+    virtual void resume_receive(connection& c) = 0;
+
+    /// \brief Check if the output of a connection is still being written.
+    virtual bool writing(const connection& c) const;
+
+    /// \brief Register an accepted connection.
+    connection& open_connection(int fd);
+
+    /// \brief Forget a connection, without closing its file descriptor.
+    void erase_connection(connection& c);
+
+    /// \brief Find the connection of a file descriptor.
+    /// \returns The connection or nullptr for a listening or unknown descriptor.
+    connection* find_connection(int fd);
+
+    /// \brief Check if a file descriptor is one of the listening sockets.
+    bool is_listener(int fd) const;
+
+    /// \brief Decide what happens to a connection once its output is entirely written.
+    /// \returns True if the connection is kept open, either for the pending responses or the next request.
+    bool keep_after_write(const connection& c) const noexcept;
+
+    /// \brief Hand the complete requests of the receive buffer to the workers, and follow the timeout of
+    ///        the connection.
+    void dispatch_requests(connection& c);
+
+    const size_t shard_;
+    const http_server_options options_;
+
+private:
+    void forward_request(connection& c, std::string&& request, zmq::message_t&& body);
+    void forward_response();
+    void process_request(connection& c, const transaction_t& transaction, std::string&& request,
+                         const zmq::message_t& body);
+    void schedule_timeout(connection& c);
+    void expire_connection(connection& c, http_connection::clock::time_point now);
+    void start_drain();
+
+    static identity_t make_identity(const connection& c);
+
+    http_dispatcher dispatcher_;
+    http_admission& admission_;
+
+    // Websites executing the requests inline, or nullptr when the workers do.
+    const std::set<http_website>* websites_;
+
+    std::vector<std::pair<uint16_t, int>> listeners_;
+    timer_wheel<connection> timers_;
+    std::unordered_map<int, connection> connections_;
+    uint32_t generation_;
+
+    // The deadline is written before the request is published, and only read after it is seen.
+    http_connection::clock::time_point drain_deadline_;
+    std::atomic<bool> drain_requested_;
+    bool draining_;
+};
+
+struct http_reactor::connection
+{
+    int fd;
+    uint32_t generation;
+
+    std::deque<http_connection::frame> output;
+    size_t output_offset; ///< Bytes of the front frame already written, or of its file for a file frame.
+
+    http_connection session;
+    bool peer_closed;
+    bool receive_paused; ///< The receive buffer was full, the engine stopped receiving until it has room.
+
+    timer_wheel<connection>::timer timer;
+
+    connection(int fd, uint32_t generation, size_t max_request_body) :
+        fd(fd), generation(generation), output_offset(0), session(max_request_body), peer_closed(false),
+        receive_paused(false), timer(*this) {}
+};
+
+#endif
@@ -1,9 +1,13 @@
 #include "http_server.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <chrono>
+#include <csignal>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <exception>
 #include <iostream>
 #include <regex>
@@ -14,39 +18,100 @@
 #include <vector>
 
 #include <boost/filesystem.hpp>
+#include <pthread.h>
+#include <signal.h>
 #include <spdlog/spdlog.h>
+#include <unistd.h>
 
+#include "cpu_topology.h"
+#include "http_epoll_reactor.h"
 #include "http_structure.hpp"
+#include "http_uring_reactor.h"
 #include "identity.h"
+#include "response_stream.h"
+#include "transaction.h"
+#include "logger.h"
 
 using namespace std::chrono_literals;
 
-http_server::http_server(uint8_t io_threads) :
-    context_(io_threads), http_socket_(context_, zmq::socket_type::stream),
-    inproc_status_socket_(context_, zmq::socket_type::pub), inproc_request_socket_(context_, zmq::socket_type::dealer)
+namespace
 {
-    logger_ = spdlog::get("server");
+
+// Set by the signal handler, only a lock-free flag can be written from it.
+volatile std::sig_atomic_t drain_signal_received = 0;
+
+extern "C" void on_drain_signal(int)
+{
+    drain_signal_received = 1;
+}
+
+}
+
+http_server::http_server(const options& opts /* = options() */) :
+    options_(opts), context_(opts.io_threads), admission_(opts.max_in_flight), http_socket_(context_, zmq::socket_type::stream),
+    inproc_status_socket_(context_, zmq::socket_type::pub), inproc_ready_socket_(context_, zmq::socket_type::pull),
+    stream_draining_(false), drain_requested_(false), shard_workers_(workers_per_shard())
+{
+    logger_ = logger::log(logger::type::server);
 
     try {
         inproc_status_socket_.bind("inproc://http_workers_status");
+        inproc_ready_socket_.bind("inproc://http_workers_ready");
     } catch (zmq::error_t& e) {
-        logger_.error() << "Server error, cannot bind the HTTP worker status channel: ";
-        logger_.error() << "Error " << zmq_errno() << ": " << e.what();
+        logger_->error() << "Server error, cannot bind the HTTP worker status channels: ";
+        logger_->error() << "Error " << zmq_errno() << ": " << e.what();
         throw e;
     }
-    try {
-        inproc_request_socket_.bind("inproc://http_workers_requests");
-    } catch (zmq::error_t& e) {
-        logger_.error() << "Server error, cannot bind the HTTP worker request channel: ";
-        logger_.error() << "Error " << zmq_errno() << ": " << e.what();
-        throw e;
+
+    if (options_.shards == 0)
+        throw std::invalid_argument("Invalid number of shards, at least one is required.");
+    if (!options_.remote_workers_endpoint.empty() && options_.run_to_completion)
+        throw std::invalid_argument("Remote workers cannot be used while running the requests to completion.");
+
+    if (options_.front_end != options::engine::zmq_stream) {
+        bool use_uring = false;
+        if (options_.front_end == options::engine::io_uring) {
+#ifdef HAVE_LIBURING
+            use_uring = http_uring_reactor::supported();
+            if (!use_uring)
+                logger_->warn() << "io_uring is not available on this system, falling back to epoll.";
+#else
+            logger_->warn() << "Built without io_uring support, falling back to epoll.";
+#endif
+        }
+
+        // Each reactor owns its request channel, the workers of its shard connect to it directly.
+        // Running to completion, the reactors execute the websites themselves.
+        for (size_t shard = 0; shard < options_.shards; ++shard) {
+            reactors_.emplace_back(make_reactor(shard, use_uring));
+            if (options_.run_to_completion)
+                reactors_.back()->run_to_completion(websites_);
+        }
+
+        // The sockets of a running server are taken over before any port is bound.
+        if (!options_.handoff_path.empty()) {
+            handoff_ = std::make_unique<listener_handoff>(options_.handoff_path);
+            inherited_ = handoff_->inherit();
+        }
+        return;
     }
+
+    if (options_.shards != 1)
+        throw std::invalid_argument("Sharding the listening ports requires a reactor engine.");
+    if (options_.run_to_completion)
+        throw std::invalid_argument("Running the requests to completion requires a reactor engine.");
+    if (!options_.handoff_path.empty())
+        throw std::invalid_argument("Handing the listening sockets over requires a reactor engine.");
+
+    stream_dispatcher_ = std::make_unique<http_dispatcher>(context_, worker_endpoint(0), shard_workers_, options_,
+                                                           options_.remote_workers_endpoint);
 }
 
 void http_server::connect(const std::string& website_path, const std::string& host_name,
-                          const uint16_t port /* = 80 */, const std::string& website_name /* = "" */)
+                          const uint16_t port /* = 80 */, const std::string& website_name /* = "" */,
+                          const size_t max_in_flight /* = 0 */)
 {
-    logger_.trace() << "Connecting to port " << port << " with hostname '" << host_name << "'...";
+    logger_->trace() << "Connecting to port " << port << " with hostname '" << host_name << "'...";
 
     // TODO: Check if the port is already used.
 
@@ -62,13 +127,20 @@ void http_server::connect(const std::string& website_path, const std::string& ho
 
         try {
             // Executing the binding.
-            std::ostringstream address_builder;
-            address_builder << "tcp://*:" << port;
-            http_socket_.bind(address_builder.str());
+            if (!reactors_.empty()) {
+                // Every shard binds its own socket on the port, the kernel balances the connections.
+                listen_reactors(port);
+            } else {
+                std::ostringstream address_builder;
+                address_builder << "tcp://*:" << port;
+                http_socket_.bind(address_builder.str());
+            }
         } catch (std::exception& e) {
             websites_.erase(insert_iter.first);
             throw;
         }
+
+        admission_.limit(insert_iter.first->host(), max_in_flight);
     } catch (zmq::error_t& e) {
         logger_->error() << "Server error, cannot connect to website '" << website_name << "' on port " << port << ".";
         logger_->error() << "Error " << zmq_errno() << ": " << e.what();
@@ -76,122 +148,534 @@ void http_server::connect(const std::string& website_path, const std::string& ho
     }
 }
 
+void http_server::inherit(uint16_t port, int fd)
+{
+    if (reactors_.empty()) {
+        ::close(fd);
+        throw std::invalid_argument("Serving a listening socket of another process requires a reactor engine.");
+    }
+    inherited_.emplace(port, fd);
+}
+
 void http_server::run()
 {
+    // The sockets of the ports no longer served are left to the previous server.
+    for (const auto& listener : inherited_)
+        ::close(listener.second);
+    inherited_.clear();
+
+    const auto started = std::chrono::steady_clock::now();
+
     // Launch the worker threads...
-    logger_->debug() << "Launching worker thread...";
-    for (size_t i = 0; i < 4; ++i) {
-        workers_.emplace_front(context_, i, websites_);
-        workers_.front().start();
+    const size_t workers = shard_workers_;
+    logger_->debug() << "Launching " << workers << " worker thread(s) per shard...";
+    if (options_.pin_threads)
+        cpus_ = cpu_topology::available_cpus();
+
+    for (size_t shard = 0; shard < options_.shards; ++shard) {
+        for (size_t i = 0; i < workers; ++i) {
+            workers_.emplace_front(context_, shard * workers + i, websites_, worker_endpoint(shard), options_);
+            workers_.front().start();
+            if (options_.pin_threads && !workers_.front().pin(assigned_cpu(shard, i + 1)))
+                logger_->warn() << "Cannot pin worker #" << shard * workers + i << " to core " << assigned_cpu(shard, i + 1) << ".";
+        }
+    }
+
+    // The server serves as soon as every worker is connected, unless it was drained in the meantime.
+    if (wait_for_workers(workers * options_.shards)) {
+        logger_->debug() << "Sending start signal...";
+        const std::string start = "START";
+        zmq::message_t start_message(start.c_str(), start.size());
+        inproc_status_socket_.send(start_message);
+
+        const auto startup = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        logger_->notice() << "Server ready in " << startup.count() << " ms.";
+
+        if (!reactors_.empty())
+            run_reactor();
+        else
+            run_stream();
+    }
+
+    // The front-ends are drained, the requests still queued past the deadline are dropped along with the workers.
+    logger_->debug() << "Shutting down server...";
+
+    const std::string quit = "QUIT";
+    zmq::message_t quit_message(quit.c_str(), quit.size());
+    inproc_status_socket_.send(quit_message);
+    for (auto& worker : workers_) {
+        worker.stop();
+    }
+
+    logger_->info() << "Server shut down.";
+}
+
+bool http_server::wait_for_workers(size_t count)
+{
+    // Every worker reports once its status and request channels are connected: no request is handed to a
+    // worker still starting, and the status messages published from now on reach every worker.
+    std::vector<zmq::pollitem_t> poll_items = {
+        zmq::pollitem_t{static_cast<void*>(inproc_ready_socket_), 0, ZMQ_POLLIN, 0}
+    };
+
+    size_t ready = 0;
+    while (ready < count) {
+        if (drain_requested())
+            return false;
+
+        try {
+            zmq::poll(poll_items, 100);
+        } catch (zmq::error_t& e) {
+            // A signal interrupted the wait, it may have asked for a drain.
+            if (e.num() != EINTR)
+                throw;
+            continue;
+        }
+
+        if (poll_items[0].revents & ZMQ_POLLIN) {
+            zmq::message_t ready_message;
+            inproc_ready_socket_.recv(&ready_message);
+            ++ready;
+        }
+    }
+    return true;
+}
+
+void http_server::drain() noexcept
+{
+    drain_requested_ = true;
+}
+
+void http_server::drain_on_signal(int signal_number /* = SIGTERM */)
+{
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = on_drain_signal;
+    ::sigemptyset(&action.sa_mask);
+    if (::sigaction(signal_number, &action, nullptr) < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot handle signal " + std::to_string(signal_number));
+}
+
+bool http_server::drain_signaled() noexcept
+{
+    return drain_signal_received != 0;
+}
+
+bool http_server::drain_requested() const noexcept
+{
+    return drain_requested_ || drain_signaled();
+}
+
+std::vector<http_dispatcher::worker_load> http_server::queue_depths() const
+{
+    if (stream_dispatcher_)
+        return stream_dispatcher_->queue_depths();
+
+    std::vector<http_dispatcher::worker_load> loads;
+    for (const auto& reactor : reactors_) {
+        const auto shard_loads = reactor->dispatcher().queue_depths();
+        loads.insert(loads.end(), shard_loads.cbegin(), shard_loads.cend());
+    }
+    return loads;
+}
+
+void http_server::run_reactor()
+{
+    // Each reactor accepts, reads and writes on its own thread and talks to the workers of its shard directly.
+    for (size_t shard = 0; shard < reactors_.size(); ++shard) {
+        reactors_[shard]->start();
+        if (options_.pin_threads && !reactors_[shard]->pin(assigned_cpu(shard, 0)))
+            logger_->warn() << "Cannot pin reactor #" << shard << " to core " << assigned_cpu(shard, 0) << ".";
+    }
+
+    // Serving the inherited sockets, the previous server can drain and the path moves to this one.
+    if (handoff_) {
+        handoff_->release_previous();
+        try {
+            handoff_->listen();
+        } catch (std::exception& e) {
+            logger_->error() << "Cannot wait for the next server, the listening sockets cannot be handed over: " << e.what();
+            handoff_.reset();
+        }
+    }
+
+    // The reactors run until they are drained, each one stops once its connections are all closed.
+    // Handing the listening sockets over to the next server drains this one.
+    while (!drain_requested()) {
+        if (!handoff_) {
+            std::this_thread::sleep_for(100ms);
+            continue;
+        }
+
+        std::vector<listener_handoff::listener> listeners;
+        for (const auto& reactor : reactors_) {
+            const auto reactor_listeners = reactor->listeners();
+            listeners.insert(listeners.end(), reactor_listeners.cbegin(), reactor_listeners.cend());
+        }
+        if (handoff_->serve(listeners, 100ms))
+            drain();
     }
 
-    logger_->debug() << "Sending start signal...";
-    const std::string start = "START";
-    zmq::message_t start_message(start.c_str(), start.size());
-    inproc_status_socket_.send(start_message);
+    logger_->info() << "Draining server...";
+    const auto deadline = http_connection::clock::now() + options_.drain_timeout;
+    for (auto& reactor : reactors_)
+        reactor->drain(deadline);
+    for (auto& reactor : reactors_)
+        reactor->wait();
+}
 
-    std::this_thread::sleep_for(500ms);
+std::string http_server::worker_endpoint(size_t shard)
+{
+    if (shard == 0)
+        return "inproc://http_workers_requests";
+    return "inproc://http_workers_requests." + std::to_string(shard);
+}
 
-    logger_->notice() << "Server ready.";
+size_t http_server::workers_per_shard() const
+{
+    if (options_.run_to_completion)
+        return 0;
+    if (options_.workers != options::auto_workers)
+        return options_.workers;
+
+    // The usable cores are shared evenly between the shards, with at least one worker each.
+    const size_t cpus = cpu_topology::usable_cpus();
+    return std::max<size_t>(1, cpus / options_.shards);
+}
+
+int http_server::assigned_cpu(size_t shard, size_t thread) const
+{
+    // Every shard runs its front-end followed by its workers on consecutive cores, wrapping around
+    // when there are more threads than cores.
+    assert(!cpus_.empty());
+    const size_t index = shard * (shard_workers_ + 1) + thread;
+    return cpus_[index % cpus_.size()];
+}
+
+std::unique_ptr<http_reactor> http_server::make_reactor(size_t shard, bool use_uring)
+{
+#ifdef HAVE_LIBURING
+    if (use_uring)
+        return std::make_unique<http_uring_reactor>(context_, worker_endpoint(shard), shard, shard_workers_, admission_, options_);
+#else
+    (void)use_uring;
+#endif
+    return std::make_unique<http_epoll_reactor>(context_, worker_endpoint(shard), shard, shard_workers_, admission_, options_);
+}
+
+void http_server::listen_reactors(uint16_t port)
+{
+    // The sockets handed over by the previous server are adopted first, the kernel kept queuing the connections
+    // on them. The shards left bind their own socket, joining the SO_REUSEPORT group of the port, and the
+    // sockets left when the previous server had more shards are shared among the reactors.
+    std::vector<int> fds;
+    const auto range = inherited_.equal_range(port);
+    for (auto it = range.first; it != range.second; ++it)
+        fds.push_back(it->second);
+    inherited_.erase(range.first, range.second);
+
+    for (size_t i = 0; i < std::max(fds.size(), reactors_.size()); ++i) {
+        http_reactor& reactor = *reactors_[i % reactors_.size()];
+        try {
+            if (i < fds.size())
+                reactor.adopt(port, fds[i]);
+            else
+                reactor.listen(port);
+        } catch (std::exception&) {
+            for (size_t j = i + 1; j < fds.size(); ++j)
+                ::close(fds[j]);
+            throw;
+        }
+    }
+}
 
+void http_server::run_stream()
+{
     // zmq_proxy doesn't work for stream sockets (identity is not sent along with the message to the same service).
     // We do the polling loop manually...
 
     //  Initialize poll set
     std::vector<zmq::pollitem_t> poll_items = {
         zmq::pollitem_t{static_cast<void*>(http_socket_), 0, ZMQ_POLLIN, 0},
-        zmq::pollitem_t{static_cast<void*>(inproc_request_socket_),  0, ZMQ_POLLIN, 0}
+        zmq::pollitem_t{static_cast<void*>(stream_dispatcher_->socket()),  0, ZMQ_POLLIN, 0}
     };
+    if (stream_dispatcher_->remote_socket() != nullptr)
+        poll_items.push_back(zmq::pollitem_t{static_cast<void*>(*stream_dispatcher_->remote_socket()), 0, ZMQ_POLLIN, 0});
+
+    // The proxy runs on the calling thread.
+    if (options_.pin_threads && !cpu_topology::pin(::pthread_self(), assigned_cpu(0, 0)))
+        logger_->warn() << "Cannot pin the proxy to core " << assigned_cpu(0, 0) << ".";
+
+    // The timeouts are checked at least every tenth of a second.
+    const long poll_timeout = 100;
+
+    http_connection::clock::time_point drain_deadline = http_connection::clock::time_point::max();
 
     try {
         while (true) {
-            zmq::poll(poll_items, -1);
+            // Once drained, the proxy stops when every connection is closed or its deadline is reached.
+            const auto now = http_connection::clock::now();
+            if (!stream_draining_ && drain_requested()) {
+                drain_deadline = now + options_.drain_timeout;
+                start_stream_drain(http_socket_);
+            }
+            if (stream_draining_ && (stream_connections_.empty() || now >= drain_deadline)) {
+                if (!stream_connections_.empty())
+                    logger_->warn() << "Drain deadline reached, closing " << stream_connections_.size() << " connection(s).";
+                break;
+            }
+
+            try {
+                zmq::poll(poll_items, poll_timeout);
+            } catch (zmq::error_t& e) {
+                // A signal interrupted the wait, it may have asked for a drain.
+                if (e.num() != EINTR)
+                    throw;
+                continue;
+            }
 
             if (poll_items[0].revents & ZMQ_POLLIN) {
                 ///////////////////////////////////////////////
                 // Forward incoming HTTP request to a worker.
-                forward_as_req(http_socket_, inproc_request_socket_);
+                forward_as_req(http_socket_, *stream_dispatcher_);
             }
 
-            if (poll_items[1].revents & ZMQ_POLLIN) {
+            if ((poll_items[1].revents & ZMQ_POLLIN) || (poll_items.size() > 2 && (poll_items[2].revents & ZMQ_POLLIN))) {
                 ///////////////////////////////////////////////
                 // Forward the HTTP response back to the client.
-                forward_as_stream(inproc_request_socket_, http_socket_);
+                forward_as_stream(*stream_dispatcher_, http_socket_);
             }
+
+            // Only the connections past their deadline are visited.
+            const auto expiry = http_connection::clock::now();
+            stream_timers_.advance(expiry, [this, expiry](stream_connection& connection) {
+                expire_stream(http_socket_, connection, expiry);
+            });
+            stream_dispatcher_->expire_workers(expiry);
+
+            // The requests of the remote workers dropped on the way are answered by the dispatcher.
+            while (stream_dispatcher_->lost_requests())
+                forward_as_stream(*stream_dispatcher_, http_socket_);
         }
     } catch (zmq::error_t& e) {
         logger_->error() << "Server error, proxy failed due to the following zmq exception: ";
         logger_->error() << "Error " << zmq_errno() << ": " << e.what();
         throw e;
     }
-
-    logger_->debug() << "Shutting down server...";
-
-    const std::string quit = "QUIT";
-    zmq::message_t quit_message(quit.c_str(), quit.size());
-    inproc_status_socket_.send(quit_message);
-    for (auto& worker : workers_) {
-        worker.stop();
-    }
-
-    logger_->info() << "Server shut down.";
 }
 
-void http_server::forward_as_req(zmq::socket_t& from, zmq::socket_t& to)
+void http_server::forward_as_req(zmq::socket_t& from, http_dispatcher& to)
 {
     // 1. Extract the identity frame of the stream socket.
     identity_t id;
     id.length = from.recv(&id.identity, id.identity.size());
 
-    // 2. Extract the full message.
+    // 2. Extract the full message, keeping every part as received.
+    std::vector<zmq::message_t> parts;
     int more;
-    std::string frame;
     do {
-        // Forward every part of the message
         zmq::message_t part;
         from.recv(&part);
-
-        frame.append(static_cast<char*>(part.data()), part.size());
+        if (part.size() > 0)
+            parts.push_back(std::move(part));
 
         size_t more_size = sizeof(more);
         from.getsockopt(ZMQ_RCVMORE, &more, &more_size);
     } while (more);
 
-    // 3. Send message if it's not empty...
-    if (!frame.empty()) {
-        to.send(&id.identity, id.length, ZMQ_SNDMORE);
-        zmq::message_t wire_response(frame.c_str(), frame.size());
-        to.send(wire_response);
+    // 3. An empty message notifies either a new connection or a disconnection. The bytes still arriving on a
+    //    connection closed by the server are dropped until its disconnection. A draining server refuses the
+    //    new connections.
+    const auto closed_it = closed_streams_.find(id);
+    if (closed_it != closed_streams_.end()) {
+        if (parts.empty())
+            closed_streams_.erase(closed_it);
+        return;
+    }
+    auto connection_it = stream_connections_.find(id);
+    if (parts.empty() && connection_it != stream_connections_.end()) {
+        stream_connections_.erase(connection_it);
+        return;
     }
+    if (connection_it == stream_connections_.end()) {
+        if (stream_draining_) {
+            close_stream(from, id);
+            return;
+        }
+        connection_it = stream_connections_.emplace(std::piecewise_construct, std::forward_as_tuple(id),
+                                                    std::forward_as_tuple(id, options_.max_request_body)).first;
+    }
+
+    // 4. Reassemble the request, a part holding exactly one request is passed through without any copy.
+    stream_connection& connection = connection_it->second;
+    for (auto& part : parts) {
+        if (connection.session.receive(static_cast<const char*>(part.data()), part.size()) &&
+            !dispatch_stream(from, to, id, connection.session, std::move(part)))
+            return;
+    }
+    dispatch_buffered(from, to, connection);
 }
 
-void http_server::forward_as_stream(zmq::socket_t& from, zmq::socket_t& to)
+bool http_server::dispatch_stream(zmq::socket_t& stream, http_dispatcher& workers, const identity_t& id,
+                                  http_connection& connection, zmq::message_t&& request,
+                                  zmq::message_t&& body /* = zmq::message_t() */)
 {
-    // 1. Extract the identity frame of the stream socket.
-    identity_t id;
-    id.length = from.recv(&id.identity, id.identity.size());
+    // A draining server asks the client to close the connection with its response.
+    const size_t max_requests = stream_draining_ ? 1 : options_.max_keep_alive_requests;
+    transaction_t transaction = connection.dispatch(max_requests);
+    if (body.size() > 0)
+        transaction.flags |= transaction_t::body_file;
+    if (admission_.admit(static_cast<const char*>(request.data()), request.size(), transaction)) {
+        workers.send(id, transaction, std::move(request), std::move(body));
+        return true;
+    }
 
-    // 2. Extract the full message.
-    int more;
-    std::string frame;
-    do {
-        // Forward every part of the message
-        zmq::message_t part;
-        from.recv(&part);
+    // Past the limits, the request is answered right away in the place of its response.
+    std::deque<http_connection::frame> output;
+    const bool keep_alive = connection.shed(transaction, options_.retry_after, output);
+    for (auto& part : output) {
+        stream.send(&id.identity, id.length, ZMQ_SNDMORE);
+        stream.send(part.message, ZMQ_SNDMORE);
+    }
+    if (!keep_alive)
+        close_stream(stream, id);
+    return keep_alive;
+}
 
-        frame.append(static_cast<char*>(part.data()), part.size());
+bool http_server::dispatch_buffered(zmq::socket_t& stream, http_dispatcher& workers, stream_connection& connection)
+{
+    // Pipelined requests are all dispatched at once, up to the limit of the connection.
+    const identity_t& id = connection.id;
+    std::string request;
+    while (true) {
+        zmq::message_t body;
+        const http_request_framer::status status = connection.session.extract_request(request, body, options_);
+        switch (status) {
+            case http_request_framer::status::complete:
+                if (!dispatch_stream(stream, workers, id, connection.session, make_zmq_message(std::move(request)),
+                                     std::move(body)))
+                    return false;
+                break;
+            case http_request_framer::status::invalid:
+            case http_request_framer::status::too_large: {
+                const bool too_large = (status == http_request_framer::status::too_large);
+                logger_->warn() << (too_large ? "Request body too large" : "Invalid request framing") << " on connection '" << id << "', closing it.";
+                zmq::message_t response = make_zmq_message(connection.session.reject(
+                    too_large ? http_constants::status::http_request_entry_too_large : http_constants::status::http_bad_request));
+                stream.send(&id.identity, id.length, ZMQ_SNDMORE);
+                stream.send(response, ZMQ_SNDMORE);
+                close_stream(stream, id);
+                return false;
+            }
+            case http_request_framer::status::incomplete:
+            default:
+                // The state of the connection moved, and its deadline along with it.
+                stream_timers_.schedule(connection.timer, connection.session.deadline(options_));
+                return true;
+        }
+    }
+}
 
-        size_t more_size = sizeof(more);
-        from.getsockopt(ZMQ_RCVMORE, &more, &more_size);
-    } while (more);
+void http_server::forward_as_stream(http_dispatcher& from, zmq::socket_t& to)
+{
+    // 1. Extract the identity frame of the stream socket, the envelope of the transaction and every part as received.
+    //    The dispatcher may only have received the announcement of a worker.
+    identity_t id;
+    transaction_t transaction;
+    std::vector<zmq::message_t> parts;
+    if (!from.receive(id, transaction, parts))
+        return;
+    if (!(transaction.flags & transaction_t::partial))
+        admission_.release(transaction);
+
+    // 2. Drop the response if the client disconnected in the meantime, stopping its stream.
+    const auto connection_it = stream_connections_.find(id);
+    if (connection_it == stream_connections_.end()) {
+        if (transaction.flags & transaction_t::partial)
+            response_stream::cancel(transaction);
+        return;
+    }
 
-    // 3. Send message if it's not empty...
-    if (!frame.empty()) {
+    // 3. Send the responses following the order of the requests, holding back those which overtook an earlier one.
+    //    A stream socket expects the identity in front of every data frame.
+    //    The stream socket only moves bytes, the workers never leave the message body in a file for it.
+    std::deque<http_connection::frame> output;
+    const bool keep_alive = connection_it->second.session.complete(transaction, std::move(parts), output);
+    for (auto& part : output) {
+        assert(!part.file);
         to.send(&id.identity, id.length, ZMQ_SNDMORE);
-        zmq::message_t wire_response(frame.c_str(), frame.size());
-        to.send(wire_response, ZMQ_SNDMORE);
+        to.send(part.message, ZMQ_SNDMORE);
+    }
 
-        to.send(&id.identity, id.length, ZMQ_SNDMORE);
-        to.send(nullptr, 0, ZMQ_SNDMORE);
+    // 4. Keep the connection open unless the worker or the connection state decided otherwise,
+    //    the next requests may already be waiting in the receive buffer.
+    //    A draining server closes the connection after its last response, unless a request is arriving.
+    if (!keep_alive)
+        close_stream(to, id);
+    else if (dispatch_buffered(to, from, connection_it->second) && stream_draining_ &&
+             connection_it->second.session.current() == http_connection::state::idle)
+        close_stream(to, id);
+}
+
+void http_server::start_stream_drain(zmq::socket_t& stream)
+{
+    logger_->info() << "Draining server, " << stream_connections_.size() << " connection(s) open...";
+    stream_draining_ = true;
+
+    // The stream socket keeps listening, the new connections are closed as soon as they are announced.
+    // The connections waiting for their next request are closed, the others after their last response.
+    std::vector<identity_t> idle;
+    for (const auto& entry : stream_connections_) {
+        if (entry.second.session.current() == http_connection::state::idle)
+            idle.push_back(entry.first);
+    }
+    for (const auto& id : idle)
+        close_stream(stream, id);
+}
+
+void http_server::close_stream(zmq::socket_t& stream, const identity_t& id)
+{
+    // Sending an empty frame to a stream socket closes the connection.
+    stream.send(&id.identity, id.length, ZMQ_SNDMORE);
+    stream.send(nullptr, 0, ZMQ_SNDMORE);
+
+    // The stream socket still notifies the disconnection, which must not announce a new connection.
+    // The identity may belong to the connection, it is copied before the connection is erased.
+    closed_streams_.insert(id);
+    stream_connections_.erase(id);
+}
+
+void http_server::expire_stream(zmq::socket_t& stream, stream_connection& connection,
+                                http_connection::clock::time_point now)
+{
+    // The identity outlives the connection, closing the stream erases it.
+    const identity_t id = connection.id;
+
+    switch (connection.session.expired(options_, now)) {
+        case http_connection::timeout::none:
+            // The deadline moved since the timer was scheduled.
+            stream_timers_.schedule(connection.timer, connection.session.deadline(options_));
+            return;
+        case http_connection::timeout::idle:
+            logger_->debug() << "Closing idle connection '" << id << "'.";
+            close_stream(stream, id);
+            return;
+        case http_connection::timeout::request:
+            // The workers did not answer in time, their responses can no longer be sent in order.
+            if (connection.session.pending() > 0) {
+                logger_->warn() << "Request timeout on connection '" << id << "', closing it.";
+                close_stream(stream, id);
+                return;
+            }
+            // fall through
+        case http_connection::timeout::header:
+        case http_connection::timeout::body: {
+            logger_->debug() << "Request not received in time on connection '" << id << "', closing it.";
+            zmq::message_t response = make_zmq_message(connection.session.reject(http_constants::status::http_request_timeout));
+            stream.send(&id.identity, id.length, ZMQ_SNDMORE);
+            stream.send(response, ZMQ_SNDMORE);
+            close_stream(stream, id);
+            return;
+        }
     }
 }
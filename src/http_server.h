@@ -2,20 +2,34 @@
 #define HTTP_SERVER_H
 
 #include <array>
+#include <atomic>
+#include <csignal>
 #include <cstdint>
+#include <map>
 #include <set>
 #include <string>
 #include <forward_list>
+#include <memory>
+#include <vector>
 
 #include <zmq.hpp>
 
+#include "http_admission.h"
+#include "http_connection.h"
+#include "http_dispatcher.h"
+#include "http_reactor.h"
+#include "http_server_options.h"
 #include "http_website.h"
 #include "http_worker.h"
+#include "listener_handoff.h"
+#include "timer_wheel.hpp"
 
 class http_server
 {
 public:
-    http_server(uint8_t io_threads = 1);
+    using options = http_server_options;
+
+    explicit http_server(const options& opts = options());
 
     http_server(const http_server&) = delete;
     http_server& operator=(const http_server&) = delete;
@@ -26,27 +40,111 @@ public:
     /// \param host_name The host name of the website. Note that this field is mandatory and used to filter the website.
     /// \param port The port to listen to. By default use port 80.
     /// \param website_name Friendly name for the website. Only used internally.
-    void connect(const std::string& website_path, const std::string& host_name, const uint16_t port = 80, const std::string& website_name = "");
+    /// \param max_in_flight Number of requests of the website handed to the workers and not answered yet, 0 for
+    ///                      no limit. The next ones are answered right away with 503 Service Unavailable.
+    void connect(const std::string& website_path, const std::string& host_name, const uint16_t port = 80,
+                 const std::string& website_name = "", const size_t max_in_flight = 0);
+
+    /// \brief Serve a listening socket opened by another process, such as a prefork_master, instead of binding
+    ///        the port: the socket is adopted when a website is connected on its port.
+    /// \note Requires a reactor engine, the server owns the socket, even when it throws. The sockets of the
+    ///       ports never connected are closed by run().
+    ///
+    /// \param port The TCP port the socket is bound to.
+    /// \param fd The listening socket.
+    void inherit(uint16_t port, int fd);
+
     void run();
 
+    /// \brief Drain the server: stop accepting connections, close the idle ones, finish the requests in
+    ///        progress, then stop the workers and return from run(), within options::drain_timeout.
+    /// \note Can be called from any thread.
+    void drain() noexcept;
+
+    /// \brief Drain every server of the process when a signal is received.
+    ///
+    /// \param signal_number The signal, such as SIGTERM or SIGINT.
+    static void drain_on_signal(int signal_number = SIGTERM);
+
+    /// \brief Check if one of the signals handled by drain_on_signal was received by the process.
+    static bool drain_signaled() noexcept;
+
+    /// \brief Number of requests in progress of each worker, identified as in the logs.
+    /// \note Can be called from any thread while the server runs, the depths are only tracked with the
+    ///       least_loaded dispatch.
+    std::vector<http_dispatcher::worker_load> queue_depths() const;
+
 private:
-    static void forward_as_req(zmq::socket_t& from, zmq::socket_t& to);
-    static void forward_as_stream(zmq::socket_t& from, zmq::socket_t& to);
+    void run_stream();
+    void run_reactor();
+    bool drain_requested() const noexcept;
+    bool wait_for_workers(size_t count);
+    void start_stream_drain(zmq::socket_t& stream);
+
+    static std::string worker_endpoint(size_t shard);
+    size_t workers_per_shard() const;
+    int assigned_cpu(size_t shard, size_t thread) const;
+    std::unique_ptr<http_reactor> make_reactor(size_t shard, bool use_uring);
+    void listen_reactors(uint16_t port);
+
+    void forward_as_req(zmq::socket_t& from, http_dispatcher& to);
+    void forward_as_stream(http_dispatcher& from, zmq::socket_t& to);
+
+    struct stream_connection;
+
+    bool dispatch_stream(zmq::socket_t& stream, http_dispatcher& workers, const identity_t& id, http_connection& connection, zmq::message_t&& request,
+                         zmq::message_t&& body = zmq::message_t());
+    bool dispatch_buffered(zmq::socket_t& stream, http_dispatcher& workers, stream_connection& connection);
+    void close_stream(zmq::socket_t& stream, const identity_t& id);
+    void expire_stream(zmq::socket_t& stream, stream_connection& connection, http_connection::clock::time_point now);
 
     struct socket_info;
 
+    const options options_;
+
     zmq::context_t context_;
+    http_admission admission_;
     zmq::socket_t http_socket_;
     zmq::socket_t inproc_status_socket_;
-    zmq::socket_t inproc_request_socket_;
+    zmq::socket_t inproc_ready_socket_;
+    std::unique_ptr<http_dispatcher> stream_dispatcher_;
+    std::vector<std::unique_ptr<http_reactor>> reactors_;
+
+    // Listening sockets handed over by the previous server, until their port is connected.
+    std::unique_ptr<listener_handoff> handoff_;
+    std::multimap<uint16_t, int> inherited_;
+
+    // Persistent connections of the ZMQ_STREAM engine, keyed by the stream identity, and their timeouts.
+    timer_wheel<stream_connection> stream_timers_;
+    std::map<identity_t, stream_connection> stream_connections_;
+    // Connections closed by the server, whose disconnection is still to be notified by the stream socket.
+    std::set<identity_t> closed_streams_;
+    bool stream_draining_;
+
+    std::atomic<bool> drain_requested_;
 
     std::set<http_website> websites_;
     std::forward_list<http_worker> workers_;
 
+    const size_t shard_workers_;
+
+    // Cores the threads are pinned to, when requested.
+    std::vector<int> cpus_;
+
     std::shared_ptr<spdlog::logger> logger_;
 };
 
 
+struct http_server::stream_connection
+{
+    const identity_t id;
+    http_connection session;
+    timer_wheel<stream_connection>::timer timer;
+
+    stream_connection(const identity_t& id, size_t max_request_body) : id(id), session(max_request_body), timer(*this) {}
+};
+
+
 struct http_server::socket_info
 {
     uint16_t port;
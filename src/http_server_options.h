@@ -0,0 +1,133 @@
+#ifndef HTTP_SERVER_OPTIONS_H
+#define HTTP_SERVER_OPTIONS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// \brief Settings of an http server, fixed at construction.
+struct http_server_options
+{
+    /// \brief Engine accepting the client connections and moving bytes to and from the workers.
+    enum class engine : uint8_t {
+        zmq_stream, ///< A ZMQ_STREAM socket proxied to the workers by the server thread.
+        epoll,      ///< A native edge-triggered epoll reactor running in its own thread.
+        io_uring    ///< A native io_uring reactor running in its own thread, falling back to epoll when the
+                    ///< kernel or the build does not support it.
+    };
+
+    /// \brief Way the front-end picks the worker processing a request.
+    enum class dispatch : uint8_t {
+        round_robin,  ///< The requests are handed to the workers in turn, whatever their load.
+        least_loaded  ///< The requests go to the worker with the fewest requests in progress, idle workers
+                      ///< first, and wait in the front-end once every worker holds worker_queue_depth requests.
+    };
+
+    /// \brief Value of workers sizing the pool from the cores available to the process.
+    static constexpr size_t auto_workers = 0;
+
+    uint8_t io_threads = 1;
+    engine  front_end = engine::zmq_stream;
+
+    /// \brief Number of workers of each shard, or auto_workers to share the usable cores (see
+    ///        cpu_topology::usable_cpus) between the shards.
+    size_t  workers = 4;
+
+    /// \brief Way the requests are balanced between the workers of a shard.
+    dispatch dispatch_mode = dispatch::round_robin;
+
+    /// \brief Number of requests handed to a worker at the same time with the least_loaded dispatch, the next
+    ///        ones wait in the front-end for a worker to answer. 1 never queues a request behind a slow one.
+    size_t  worker_queue_depth = 1;
+
+    /// \brief Endpoint the workers of other processes or hosts connect to, such as tcp://*:5570, empty to only use
+    ///        the workers of the server. Requires the least_loaded dispatch, the requests are balanced between
+    ///        the local and the remote workers by their load. With several shards, only the first one accepts
+    ///        remote workers. See http_worker_node.
+    std::string remote_workers_endpoint;
+
+    /// \brief Number of remote workers the front-end accepts at the same time.
+    size_t  max_remote_workers = 64;
+
+    /// \brief Time between the heartbeats of a remote worker.
+    std::chrono::milliseconds heartbeat_interval = std::chrono::seconds(1);
+
+    /// \brief Number of heartbeats a remote worker may miss before it is dropped. A worker busy with a request
+    ///        cannot send its heartbeats, it is dropped past request_timeout instead.
+    size_t  heartbeat_liveness = 3;
+
+    /// \brief Pin the front-end and worker threads to distinct cores, in turn, each shard on consecutive cores.
+    bool    pin_threads = false;
+
+    /// \brief Process the requests on the reactor thread which received them, without any worker thread.
+    /// \note Only supported by the reactor engines, each shard then runs its listener, the parsing, the website
+    ///       and the writes on a single thread: set shards to the number of cores, along with pin_threads.
+    bool    run_to_completion = false;
+
+    /// \brief Number of reactors sharing each port through SO_REUSEPORT, each with its own workers.
+    /// \note Only supported by the reactor engines.
+    size_t  shards = 1;
+
+    /// \brief Time an idle persistent connection is kept open waiting for its next request.
+    std::chrono::milliseconds keep_alive_timeout = std::chrono::seconds(5);
+
+    /// \brief Time allowed to receive a request header from its first byte, 0 for no limit. A client sending
+    ///        its header too slowly is answered with 408 Request Timeout.
+    std::chrono::milliseconds header_timeout = std::chrono::seconds(10);
+
+    /// \brief Time allowed to receive a request body once its header is received, 0 for no limit.
+    std::chrono::milliseconds body_timeout = std::chrono::seconds(30);
+
+    /// \brief Time allowed for a request from its first byte to its response, 0 for no limit. The connection
+    ///        is closed when the workers do not answer in time.
+    std::chrono::milliseconds request_timeout = std::chrono::seconds(60);
+
+    /// \brief Path of the Unix socket the listening sockets are handed over on, empty to disable the handoff.
+    ///        A server started with the path of a running one takes over its listening sockets, then lets it
+    ///        drain, and waits on the path for the next one. Requires a reactor engine.
+    std::string handoff_path;
+
+    /// \brief Time allowed to the requests in progress to complete once the server drains, the connections
+    ///        left are closed and the workers stopped past it.
+    std::chrono::milliseconds drain_timeout = std::chrono::seconds(30);
+
+    /// \brief Bytes of a streamed message body produced ahead of the client, the producer waits past them.
+    size_t  stream_window = 256 * 1024;
+
+    /// \brief Length of a request body kept in memory, a longer one is written to a file as it arrives and
+    ///        handed to the workers as a file, 0 to keep every body in memory.
+    size_t  body_spill_threshold = 1024 * 1024;
+
+    /// \brief Length of a request body accepted, a longer one is answered with 413 Request Entity Too Large before
+    ///        any of it is buffered or spilled, 0 for no limit.
+    size_t  max_request_body = 64 * 1024 * 1024;
+
+    /// \brief Directory of the files holding the spilled request bodies, empty for anonymous memory files
+    ///        (memfd), which are swapped out rather than written to a disk.
+    std::string body_spill_directory;
+
+    /// \brief Number of requests served on a persistent connection before closing it, 0 for no limit.
+    size_t  max_keep_alive_requests = 100;
+
+    /// \brief Number of pipelined requests of a connection processed at the same time, the next ones wait
+    ///        in the receive buffer.
+    size_t  max_pipelined_requests = 16;
+
+    /// \brief Number of requests of the whole server handed to the workers and not answered yet, 0 for no limit.
+    ///        The next ones are answered right away with 503 Service Unavailable.
+    /// \note Each website can have its own limit as well, see http_server::connect.
+    size_t  max_in_flight = 0;
+
+    /// \brief Delay suggested to the clients of the requests shed, in the Retry-After header.
+    std::chrono::seconds retry_after = std::chrono::seconds(1);
+
+    /// \brief Time a request may wait for a worker before the workers start shedding the requests, following
+    ///        the CoDel algorithm, 0 to never shed on the queuing delay.
+    std::chrono::milliseconds codel_target = std::chrono::milliseconds(0);
+
+    /// \brief Time the queuing delay must stay above codel_target before the first request is shed.
+    std::chrono::milliseconds codel_interval = std::chrono::milliseconds(100);
+};
+
+#endif
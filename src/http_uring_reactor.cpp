@@ -0,0 +1,402 @@
+#include "http_uring_reactor.h"
+
+#ifdef HAVE_LIBURING
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "transaction.h"
+
+namespace
+{
+
+constexpr unsigned RING_ENTRIES = 1024;
+constexpr unsigned MAX_COMPLETIONS = 256;
+constexpr size_t READ_CHUNK_SIZE = 16 * 1024;
+constexpr size_t MAX_SEND_PARTS = 64;
+constexpr size_t FILE_CHUNK_SIZE = 64 * 1024;
+
+}
+
+http_uring_reactor::io_state::io_state() :
+    input(new char[READ_CHUNK_SIZE]), sending_offset(0), sending_file(false), file_chunk(0), file_sent(0),
+    in_flight(0), closed(false)
+{
+    std::memset(&message, 0, sizeof(message));
+}
+
+http_uring_reactor::http_uring_reactor(zmq::context_t& context, const std::string& worker_endpoint, size_t shard, size_t workers,
+                                       http_admission& admission, const http_server_options& options) :
+    http_reactor(context, worker_endpoint, shard, workers, admission, options), queued_(0)
+{
+    const int result = ::io_uring_queue_init(RING_ENTRIES, &ring_, 0);
+    if (result < 0)
+        throw std::system_error(-result, std::system_category(), "Cannot create the io_uring instance");
+}
+
+http_uring_reactor::~http_uring_reactor()
+{
+    // Stop the event loop before releasing the ring, the kernel drops the operations still in flight.
+    stop();
+    ::io_uring_queue_exit(&ring_);
+
+    // The connections still registered are closed by the base class, only those waiting for their
+    // operations to complete are left.
+    for (const auto& io : io_) {
+        if (io.second.closed)
+            ::close(io.first);
+    }
+}
+
+bool http_uring_reactor::supported() noexcept
+{
+    io_uring ring;
+    if (::io_uring_queue_init(1, &ring, 0) < 0)
+        return false;
+    ::io_uring_queue_exit(&ring);
+    return true;
+}
+
+void http_uring_reactor::add_listener(int fd)
+{
+    submit_accept(fd);
+}
+
+void http_uring_reactor::remove_listener(int fd)
+{
+    // The accept in flight holds the socket open, shutting it down completes the accept with an error.
+    ::shutdown(fd, SHUT_RDWR);
+}
+
+void http_uring_reactor::flush()
+{
+    // A single system call hands every operation queued during the iteration to the kernel.
+    if (queued_ > 0) {
+        ::io_uring_submit(&ring_);
+        queued_ = 0;
+    }
+}
+
+void http_uring_reactor::process_events()
+{
+    std::array<io_uring_cqe*, MAX_COMPLETIONS> completions;
+    while (true) {
+        const unsigned count = ::io_uring_peek_batch_cqe(&ring_, completions.data(), MAX_COMPLETIONS);
+        if (count == 0)
+            return;
+
+        for (unsigned i = 0; i < count; ++i) {
+            const uint64_t data = ::io_uring_cqe_get_data64(completions[i]);
+            const int fd = static_cast<int>(data >> 8);
+            const int result = completions[i]->res;
+
+            switch (static_cast<operation>(data & 0xff)) {
+                case operation::accept:
+                    complete_accept(fd, result);
+                    break;
+                case operation::receive:
+                    complete_receive(fd, result);
+                    break;
+                case operation::send:
+                    complete_send(fd, result);
+                    break;
+                case operation::read:
+                    complete_read(fd, result);
+                    break;
+            }
+        }
+        ::io_uring_cq_advance(&ring_, count);
+    }
+}
+
+bool http_uring_reactor::write_connection(connection& c)
+{
+    io_state& io = io_.at(c.fd);
+    if (!c.output.empty()) {
+        submit_send(c, io);
+        return true;
+    }
+    // The send in flight resumes the output once it completes.
+    if (!io.sending.empty())
+        return true;
+    return keep_after_write(c);
+}
+
+void http_uring_reactor::close_connection(connection& c)
+{
+    const int fd = c.fd;
+    erase_connection(c);
+
+    // Shutting the socket down completes the receive in flight, the descriptor is only closed
+    // once the kernel is done with the buffers of the connection.
+    io_state& io = io_.at(fd);
+    io.closed = true;
+    ::shutdown(fd, SHUT_RDWR);
+    if (io.in_flight == 0)
+        release(fd);
+}
+
+bool http_uring_reactor::writing(const connection& c) const
+{
+    // The frames being sent are moved out of the output.
+    return !c.output.empty() || !io_.at(c.fd).sending.empty();
+}
+
+void http_uring_reactor::resume_receive(connection& c)
+{
+    submit_receive(c.fd, io_.at(c.fd));
+}
+
+io_uring_sqe* http_uring_reactor::next_sqe(int fd, operation op)
+{
+    io_uring_sqe* sqe = ::io_uring_get_sqe(&ring_);
+    if (sqe == nullptr) {
+        // The submission queue is full, hand it over to the kernel to make room.
+        ::io_uring_submit(&ring_);
+        queued_ = 0;
+        sqe = ::io_uring_get_sqe(&ring_);
+        if (sqe == nullptr)
+            throw std::system_error(EBUSY, std::system_category(), "The io_uring submission queue is full");
+    }
+
+    ::io_uring_sqe_set_data64(sqe, (static_cast<uint64_t>(fd) << 8) | static_cast<uint64_t>(op));
+    ++queued_;
+    return sqe;
+}
+
+void http_uring_reactor::submit_accept(int listener)
+{
+    io_uring_sqe* sqe = next_sqe(listener, operation::accept);
+    ::io_uring_prep_accept(sqe, listener, nullptr, nullptr, SOCK_CLOEXEC);
+}
+
+void http_uring_reactor::submit_receive(int fd, io_state& io)
+{
+    io_uring_sqe* sqe = next_sqe(fd, operation::receive);
+    ::io_uring_prep_recv(sqe, fd, io.input.get(), READ_CHUNK_SIZE, 0);
+    ++io.in_flight;
+}
+
+void http_uring_reactor::submit_send(connection& c, io_state& io)
+{
+    if (!io.sending.empty())
+        return;
+
+    // The frames are moved out of the output for the time of the send, along with the position in the
+    // first one: the output can grow, or the connection be closed, while the kernel reads them.
+    io.sending_offset = c.output_offset;
+    c.output_offset = 0;
+
+    if (c.output.front().file) {
+        io.sending.push_back(std::move(c.output.front().message));
+        c.output.pop_front();
+        io.sending_file = true;
+        submit_file_read(c.fd, io);
+        return;
+    }
+
+    while (!c.output.empty() && !c.output.front().file && io.sending.size() < MAX_SEND_PARTS) {
+        io.sending.push_back(std::move(c.output.front().message));
+        c.output.pop_front();
+    }
+
+    io.iov.resize(io.sending.size());
+    for (size_t i = 0; i < io.sending.size(); ++i) {
+        const size_t offset = (i == 0) ? io.sending_offset : 0;
+        io.iov[i].iov_base = static_cast<char*>(io.sending[i].data()) + offset;
+        io.iov[i].iov_len = io.sending[i].size() - offset;
+    }
+    io.message.msg_iov = io.iov.data();
+    io.message.msg_iovlen = io.iov.size();
+
+    // Hold the segment back when a file follows, so the header leaves along with the beginning of the body.
+    const unsigned more = (!c.output.empty() && c.output.front().file) ? MSG_MORE : 0;
+
+    io_uring_sqe* sqe = next_sqe(c.fd, operation::send);
+    ::io_uring_prep_sendmsg(sqe, c.fd, &io.message, MSG_NOSIGNAL | more);
+    ++io.in_flight;
+}
+
+void http_uring_reactor::submit_file_read(int fd, io_state& io)
+{
+    const file_frame_t& file = *static_cast<const file_frame_t*>(io.sending.front().data());
+    const uint64_t remaining = file.length - io.sending_offset;
+
+    if (!io.file_buffer)
+        io.file_buffer.reset(new char[FILE_CHUNK_SIZE]);
+
+    io_uring_sqe* sqe = next_sqe(fd, operation::read);
+    ::io_uring_prep_read(sqe, file.fd, io.file_buffer.get(), static_cast<unsigned>(std::min<uint64_t>(remaining, FILE_CHUNK_SIZE)),
+                         file.offset + io.sending_offset);
+    ++io.in_flight;
+}
+
+void http_uring_reactor::submit_file_send(int fd, io_state& io)
+{
+    io.iov.resize(1);
+    io.iov[0].iov_base = io.file_buffer.get() + io.file_sent;
+    io.iov[0].iov_len = io.file_chunk - io.file_sent;
+    io.message.msg_iov = io.iov.data();
+    io.message.msg_iovlen = io.iov.size();
+
+    io_uring_sqe* sqe = next_sqe(fd, operation::send);
+    ::io_uring_prep_sendmsg(sqe, fd, &io.message, MSG_NOSIGNAL);
+    ++io.in_flight;
+}
+
+void http_uring_reactor::complete_accept(int listener, int result)
+{
+    // The listener was removed while draining, a connection accepted in the meantime is refused.
+    if (!is_listener(listener)) {
+        if (result >= 0)
+            ::close(result);
+        return;
+    }
+
+    // Accepts are one-shot, the next one is queued right away.
+    submit_accept(listener);
+
+    if (result < 0) {
+        logger::log(logger::type::server)->warn() << "Cannot accept connection: " << std::strerror(-result);
+        return;
+    }
+
+    const int fd = result;
+    const int enable = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    // The buffers of a previous connection are only released with its descriptor, so they are never reused.
+    open_connection(fd);
+    submit_receive(fd, io_[fd]);
+}
+
+void http_uring_reactor::complete_receive(int fd, int result)
+{
+    io_state& io = io_.at(fd);
+    --io.in_flight;
+    if (io.closed) {
+        if (io.in_flight == 0)
+            release(fd);
+        return;
+    }
+
+    connection& c = *find_connection(fd);
+    if (result < 0) {
+        close_connection(c);
+        return;
+    }
+
+    if (result == 0) {
+        // A client may half-close after sending its request, keep the connection until it is answered.
+        c.peer_closed = true;
+    } else {
+        // The next receive waits for room in the receive buffer, see resume_receive.
+        c.session.input().append(io.input.get(), static_cast<size_t>(result));
+        dispatch_requests(c);
+        if (c.session.input_full(options_))
+            c.receive_paused = true;
+        else
+            submit_receive(fd, io);
+    }
+
+    if (!write_connection(c))
+        close_connection(c);
+}
+
+void http_uring_reactor::complete_send(int fd, int result)
+{
+    io_state& io = io_.at(fd);
+    --io.in_flight;
+
+    if (io.closed) {
+        io.sending.clear();
+        if (io.in_flight == 0)
+            release(fd);
+        return;
+    }
+
+    connection& c = *find_connection(fd);
+    if (result < 0) {
+        close_connection(c);
+        return;
+    }
+
+    if (io.sending_file) {
+        // Finish the chunk read from the file before reading the next one.
+        io.file_sent += static_cast<size_t>(result);
+        if (io.file_sent < io.file_chunk) {
+            submit_file_send(fd, io);
+            return;
+        }
+
+        const file_frame_t& file = *static_cast<const file_frame_t*>(io.sending.front().data());
+        const uint64_t progress = io.sending_offset + io.file_chunk;
+        if (progress < file.length) {
+            io.sending_offset = progress;
+            submit_file_read(fd, io);
+            return;
+        }
+
+        io.sending.clear();
+        io.sending_file = false;
+    } else {
+        std::vector<zmq::message_t> sending;
+        sending.swap(io.sending);
+
+        // Put the frames the kernel did not take back at the front of the output.
+        size_t sent = static_cast<size_t>(result) + io.sending_offset;
+        size_t first_unsent = 0;
+        while (first_unsent < sending.size() && sent >= sending[first_unsent].size()) {
+            sent -= sending[first_unsent].size();
+            ++first_unsent;
+        }
+        for (size_t i = sending.size(); i > first_unsent; --i)
+            c.output.emplace_front(std::move(sending[i - 1]));
+        if (first_unsent < sending.size())
+            c.output_offset = sent;
+    }
+
+    if (!write_connection(c))
+        close_connection(c);
+}
+
+void http_uring_reactor::complete_read(int fd, int result)
+{
+    io_state& io = io_.at(fd);
+    --io.in_flight;
+
+    if (io.closed) {
+        io.sending.clear();
+        if (io.in_flight == 0)
+            release(fd);
+        return;
+    }
+
+    // The file shrank since the response announced its length, the response cannot be completed.
+    connection& c = *find_connection(fd);
+    if (result <= 0) {
+        close_connection(c);
+        return;
+    }
+
+    io.file_chunk = static_cast<size_t>(result);
+    io.file_sent = 0;
+    submit_file_send(fd, io);
+}
+
+void http_uring_reactor::release(int fd)
+{
+    ::close(fd);
+    io_.erase(fd);
+}
+
+#endif
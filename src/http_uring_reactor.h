@@ -0,0 +1,108 @@
+#ifndef HTTP_URING_REACTOR_H
+#define HTTP_URING_REACTOR_H
+
+#ifdef HAVE_LIBURING
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <liburing.h>
+#include <zmq.hpp>
+
+#include "http_reactor.h"
+#include "http_server_options.h"
+
+/// \brief Reactor engine built on an io_uring submission and completion queue.
+///
+/// Accepts, receives and sends are queued on the ring during an iteration of the event loop and submitted
+/// with a single system call before waiting, their completions are then reaped in batches without any
+/// system call. A connection keeps one receive and at most one send in flight. The message bodies left in
+/// a file are read through the same ring, one chunk at a time, before being sent.
+class http_uring_reactor : public http_reactor
+{
+public:
+    /// \brief Constructor of the reactor.
+    /// \see http_reactor::http_reactor
+    /// \throws std::system_error if the ring cannot be created.
+    http_uring_reactor(zmq::context_t& context, const std::string& worker_endpoint, size_t shard, size_t workers,
+                       http_admission& admission, const http_server_options& options);
+    ~http_uring_reactor();
+
+    /// \brief Check if the running kernel lets this process create a ring.
+    /// \note io_uring may be missing from older kernels or disabled by a seccomp profile or a sysctl.
+    static bool supported() noexcept;
+
+protected:
+    const char* engine_name() const noexcept override { return "io_uring"; }
+    int event_descriptor() const noexcept override { return ring_.ring_fd; }
+    void add_listener(int fd) override;
+    void remove_listener(int fd) override;
+    void process_events() override;
+    void flush() override;
+    bool write_connection(connection& c) override;
+    void close_connection(connection& c) override;
+    bool writing(const connection& c) const override;
+    void resume_receive(connection& c) override;
+
+private:
+    enum class operation : uint8_t {
+        accept,
+        receive,
+        send,
+        read
+    };
+
+    struct io_state;
+
+    io_uring_sqe* next_sqe(int fd, operation op);
+
+    void submit_accept(int listener);
+    void submit_receive(int fd, io_state& io);
+    void submit_send(connection& c, io_state& io);
+    void submit_file_read(int fd, io_state& io);
+    void submit_file_send(int fd, io_state& io);
+
+    void complete_accept(int listener, int result);
+    void complete_receive(int fd, int result);
+    void complete_send(int fd, int result);
+    void complete_read(int fd, int result);
+
+    void release(int fd);
+
+    io_uring ring_;
+    unsigned queued_;
+
+    // Buffers of the operations in flight, kept until their completion even once the connection is closed.
+    std::unordered_map<int, io_state> io_;
+};
+
+struct http_uring_reactor::io_state
+{
+    std::unique_ptr<char[]> input;
+
+    std::vector<zmq::message_t> sending;
+    size_t sending_offset;
+    std::vector<iovec> iov;
+    msghdr message;
+
+    // A file frame being sent: the chunk read from the file, and how much of it was sent.
+    bool sending_file;
+    std::unique_ptr<char[]> file_buffer;
+    size_t file_chunk;
+    size_t file_sent;
+
+    unsigned in_flight;
+    bool closed;
+
+    io_state();
+};
+
+#endif
+
+#endif
@@ -15,9 +15,14 @@ http_website::~http_website()
 {
 }
 
-http_response http_website::execute(const http_request& request) const
+http_response http_website::execute(const http_request& request, bool allow_file_body /* = false */) const
 {
-    return service_.execute(request);
+    return service_.execute(request, allow_file_body);
+}
+
+http_response http_website::execute(const http_request_view& request, bool allow_file_body /* = false */) const
+{
+    return service_.execute(request, allow_file_body);
 }
 
 bool http_website::operator==(const std::string& host) const
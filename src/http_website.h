@@ -14,7 +14,10 @@ public:
     http_website(const std::string& website_path, http_service::host&& h, const std::string& website_name = "") noexcept;
     ~http_website();
 
-    http_response execute(const http_request& request) const;
+    /// \brief Execute a request on the website.
+    /// \see http_service::execute
+    http_response execute(const http_request& request, bool allow_file_body = false) const;
+    http_response execute(const http_request_view& request, bool allow_file_body = false) const;
 
     bool operator==(const std::string& host) const;
     bool operator==(const http_service::host& other) const;
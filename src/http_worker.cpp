@@ -1,24 +1,38 @@
 #include "http_worker.h"
 
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <exception>
 #include <regex>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <vector>
 
 #include <boost/date_time/local_time/local_time.hpp>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "http_connection.h"
+#include "http_dispatcher.h"
 #include "http_exception.h"
 #include "http_structure.hpp"
 
 #include "logger.h"
 #include "identity.h"
+#include "transaction.h"
 
 using namespace std::chrono_literals;
 
-http_worker::http_worker(zmq::context_t& context, size_t id, const std::set<http_website>& ws) :
-    main_context_(context), identifier_(id), websites_(ws)
+http_worker::http_worker(zmq::context_t& context, size_t id, const std::set<http_website>& ws,
+                         const std::string& request_endpoint, const http_server_options& options) :
+    main_context_(context), identifier_(id), websites_(ws), request_endpoint_(request_endpoint),
+    dispatch_mode_(options.dispatch_mode), retry_after_(options.retry_after),
+    remote_(request_endpoint.compare(0, 9, "inproc://") != 0), heartbeat_interval_(options.heartbeat_interval),
+    codel_(options.codel_target, options.codel_interval), stream_window_(options.stream_window)
 {
 }
 
@@ -26,34 +40,61 @@ void http_worker::run()
 {
     zmq::socket_t inproc_status_socket(main_context_, zmq::socket_type::sub);
     zmq::socket_t inproc_request_socket(main_context_, zmq::socket_type::dealer);
-    try {
-        inproc_status_socket.connect("inproc://http_workers_status");
-        // Subscribe on everything
-        inproc_status_socket.setsockopt(ZMQ_SUBSCRIBE, "", 0);
-    } catch (zmq::error_t& e) {
-        logger::log(logger::type::worker)->error() << "Server error, cannot connect the HTTP worker status channel: ";
-        logger::log(logger::type::worker)->error() << "Error " << zmq_errno() << ": " << e.what();
-        throw e;
+    if (!remote_) {
+        try {
+            inproc_status_socket.connect("inproc://http_workers_status");
+            // Subscribe on everything
+            inproc_status_socket.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+        } catch (zmq::error_t& e) {
+            logger::log(logger::type::worker)->error() << "Server error, cannot connect the HTTP worker status channel: ";
+            logger::log(logger::type::worker)->error() << "Error " << zmq_errno() << ": " << e.what();
+            throw e;
+        }
     }
     try {
-        inproc_request_socket.connect("inproc://http_workers_requests");
+        // The responses of a remote worker are given up shortly once the front-end is gone.
+        if (remote_) {
+            const int linger = static_cast<int>(heartbeat_interval_.count());
+            inproc_request_socket.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+        }
+        http_dispatcher::connect(inproc_request_socket, request_endpoint_, identifier_, dispatch_mode_);
     } catch (zmq::error_t& e) {
         logger::log(logger::type::worker)->error() << "Server error, cannot connect the HTTP worker request channel: ";
         logger::log(logger::type::worker)->error() << "Error " << zmq_errno() << ": " << e.what();
         throw e;
     }
 
-    logger::log(logger::type::worker)->info() << "Worker #" << identifier_ << " online.";
+    // The server waits for every worker before serving.
+    if (!remote_) {
+        try {
+            zmq::socket_t inproc_ready_socket(main_context_, zmq::socket_type::push);
+            inproc_ready_socket.connect("inproc://http_workers_ready");
+            const uint64_t identifier = identifier_;
+            inproc_ready_socket.send(&identifier, sizeof(identifier));
+        } catch (zmq::error_t& e) {
+            logger::log(logger::type::worker)->error() << "Server error, cannot report the HTTP worker as ready: ";
+            logger::log(logger::type::worker)->error() << "Error " << zmq_errno() << ": " << e.what();
+            throw e;
+        }
+    }
+
+    logger::log(logger::type::worker)->info() << "Worker #" << identifier_ << " online" << (remote_ ? ", connected to " + request_endpoint_ : std::string()) << ".";
 
-    // Initialize the lists of sockets to poll from
+    // Initialize the lists of sockets to poll from, the streams are resumed when their event is notified.
+    stream_wakeup_ = std::make_shared<response_stream::wakeup>();
     std::vector<zmq::pollitem_t> poll_items = {
         zmq::pollitem_t{static_cast<void*>(inproc_status_socket), 0, ZMQ_POLLIN, 0},
-        zmq::pollitem_t{static_cast<void*>(inproc_request_socket), 0, ZMQ_POLLIN, 0}
+        zmq::pollitem_t{static_cast<void*>(inproc_request_socket), 0, ZMQ_POLLIN, 0},
+        zmq::pollitem_t{nullptr, stream_wakeup_->descriptor(), ZMQ_POLLIN, 0}
     };
 
+    // A remote worker wakes up for its heartbeats, and checks whether it was stopped.
+    const long poll_timeout = remote_ ? static_cast<long>(heartbeat_interval_.count()) : -1;
+    auto next_heartbeat = std::chrono::steady_clock::now() + heartbeat_interval_;
+
     while (running) {
         try {
-            zmq::poll(poll_items, -1);
+            zmq::poll(poll_items, poll_timeout);
 
             // Handle status message in priority
             if (poll_items[0].revents & ZMQ_POLLIN) {
@@ -63,19 +104,36 @@ void http_worker::run()
             if (poll_items[1].revents & ZMQ_POLLIN) {
                 handle_request(inproc_request_socket);
             }
+            // Resume the streams the front-end caught up with
+            if (poll_items[2].revents & ZMQ_POLLIN) {
+                stream_wakeup_->clear();
+                pump_streams(inproc_request_socket);
+            }
+            // Keep the worker alive in the front-end, even after a long request
+            if (remote_ && std::chrono::steady_clock::now() >= next_heartbeat) {
+                http_dispatcher::heartbeat(inproc_request_socket);
+                next_heartbeat = std::chrono::steady_clock::now() + heartbeat_interval_;
+            }
         } catch (zmq::error_t& e) {
             logger::log(logger::type::worker)->error() << "Exception caught in worker thread #" << identifier_ << ":";
             logger::log(logger::type::worker)->error() << "Error " << zmq_errno() << ": " << e.what();
         }
     }
 
+    // The front-end stops sending requests to a remote worker at once, instead of waiting for its heartbeats.
+    if (remote_) {
+        try {
+            http_dispatcher::leave(inproc_request_socket);
+        } catch (zmq::error_t& e) {
+            logger::log(logger::type::worker)->warn() << "Worker #" << identifier_ << " cannot leave the front-end: " << e.what();
+        }
+    }
+
     logger::log(logger::type::worker)->info() << "Worker #" << identifier_ << " shut down.";
 }
 
 void http_worker::handle_status(zmq::socket_t& socket)
 {
-    std::this_thread::sleep_for(std::chrono::milliseconds(identifier_ * 10));
-
     logger::log(logger::type::worker)->debug() << "Worker #" << identifier_ << ": receiving status code...";
     zmq::message_t status_message;
     socket.recv(&status_message);
@@ -94,56 +152,174 @@ void http_worker::handle_request(zmq::socket_t& socket)
     identity_t id;
     id.length = socket.recv(&id.identity, id.identity.size());
 
+    transaction_t transaction;
+    socket.recv(&transaction, sizeof(transaction));
+
+    // The descriptors of a remote worker mean nothing to the front-end.
+    if (remote_)
+        transaction.flags &= static_cast<uint8_t>(~transaction_t::file_body);
+
     // Construct a transaction for the request.
     logger::log(logger::type::worker)->debug() << "Worker #" << identifier_ << ": processing transaction '" << id << "'.";
 
-    http_response response;
-    try {
-        ///////////////////////////////////////////////////
-        // 1. Extract the request from the inproc messaging queue.
+    ///////////////////////////////////////////////////
+    // 1. Extract the request from the inproc messaging queue.
+
+    std::string frame;
+    // Extract the request itself, a message body spilled by the front-end is the file of the last frame.
+    zmq::message_t request_body;
+    int64_t more;
+    do {
+        zmq::message_t part;
+        socket.recv(&part);
+
+        size_t more_size = sizeof(more);
+        socket.getsockopt(ZMQ_RCVMORE, &more, &more_size);
+
+        if (!more && (transaction.flags & transaction_t::body_file))
+            request_body.move(&part);
+        else
+            frame.append(static_cast<char*>(part.data()), part.size());
+    } while (more);
+
+    // The request waited too long in the queues, the server is overloaded: answer without executing it.
+    // The clock of a remote front-end cannot be compared with the one of the worker.
+    const auto dispatched = codel::clock::time_point(std::chrono::nanoseconds(transaction.dispatched));
+    std::vector<zmq::message_t> parts;
+    streamed_body body{};
+    if (!remote_ && codel_.shed(codel::clock::now() - dispatched)) {
+        logger::log(logger::type::worker)->debug() << "Worker #" << identifier_ << ": shedding transaction '" << id << "'.";
+        transaction.flags = static_cast<uint8_t>(transaction.flags & transaction_t::close);
+        parts.push_back(make_zmq_message(http_connection::error_response(http_constants::status::http_service_unavailable,
+                                                                         (transaction.flags & transaction_t::close) != 0,
+                                                                         retry_after_)));
+    } else {
+        const file_frame_t* body_file = (request_body.size() == sizeof(file_frame_t))
+                                        ? static_cast<const file_frame_t*>(request_body.data()) : nullptr;
+        parts = process(websites_, identifier_, transaction, std::move(frame), body_file, remote_ ? nullptr : &body);
+    }
 
-        std::string frame;
-        // Extract the request itself.
-        int64_t more;
-        do {
-            zmq::message_t part;
-            socket.recv(&part);
+    // The message body is streamed after the serialized response, as the front-end writes it.
+    if (body.producer) {
+        streams_.emplace_back(id, transaction, std::move(parts), std::move(body.producer), body.chunked,
+                              stream_wakeup_, stream_window_);
+        if (streams_.back().pump(socket))
+            streams_.pop_back();
+        return;
+    }
 
-            frame.append(static_cast<char*>(part.data()), part.size());
+    ///////////////////////////////////////////////////
+    // 7. Complete the request, the file follows the serialized response.
+    socket.send(&id.identity, id.length, ZMQ_SNDMORE);
+    socket.send(&transaction, sizeof(transaction), ZMQ_SNDMORE);
+    for (size_t i = 0; i < parts.size(); ++i)
+        socket.send(parts[i], (i + 1 < parts.size()) ? ZMQ_SNDMORE : 0);
+}
 
-            size_t more_size = sizeof(more);
-            socket.getsockopt(ZMQ_RCVMORE, &more, &more_size);
-        } while (more);
+std::vector<zmq::message_t> http_worker::process(const std::set<http_website>& websites, size_t identifier,
+                                                 transaction_t& transaction, std::string&& frame,
+                                                 const file_frame_t* request_body /* = nullptr */,
+                                                 streamed_body* body /* = nullptr */)
+{
+    // The front-end says whether it can write a message body left in a file.
+    const bool file_body_allowed = (transaction.flags & transaction_t::file_body) != 0;
 
+    http_response response;
+    bool keep_alive = false;
+    bool head_request = false;
+    try {
         ///////////////////////////////////////////////////
         // 2. Detect the website based on the host/port of the requets-URI.
-        const http_request request = http_service::parse_request(frame);
-        const http_website& website = find_website(request);
+        http_request_view request = http_service::parse_request_view(std::make_shared<const std::string>(std::move(frame)));
+        if (request_body != nullptr)
+            request.file_body = open_file_body(*request_body);
+        const http_website& website = find_website(websites, request);
 
         logger::log(logger::type::worker)->info() << website.host() << " '" << request.method << " " << request.request_uri << " " << request.http_version << "'";
 
+        // The front-end may already have decided to close the connection.
+        keep_alive = !(transaction.flags & transaction_t::close) && request.keep_alive();
+        head_request = (request.method == http_constants::method::m_head);
+
         ///////////////////////////////////////////////////
         // 3. Execute the http request.
-        response = website.execute(request);
+        response = website.execute(request, file_body_allowed);
+
+        // Without a stream to send it on, the message body is produced entirely right away.
+        if (response.body_producer && (body == nullptr || head_request)) {
+            std::string message_body = response.message_body;
+            std::string chunk;
+            while (!head_request && response.body_producer(chunk)) {
+                message_body += chunk;
+                chunk.clear();
+            }
+            message_body += chunk;
+            response.message_body = std::move(message_body);
+            response.body_producer = nullptr;
+        }
     } catch(http_invalid_request& e) {
         response.status_code = http_constants::status::http_bad_request;
+        response.body_producer = nullptr;
     } catch(...) {
         response.status_code = http_constants::status::http_internal_server_error;
+        response.body_producer = nullptr;
+    }
+
+    ///////////////////////////////////////////////////
+    // 4. Hand the file of the message body over to the front-end, which owns its own descriptor.
+    zmq::message_t file_message;
+    const bool file_body = !head_request && response.file_body && response.file_body.length > 0;
+    if (file_body) {
+        const int fd = ::fcntl(*response.file_body.descriptor, F_DUPFD_CLOEXEC, 0);
+        if (fd < 0) {
+            logger::log(logger::type::worker)->error() << "Worker #" << identifier << ": cannot hand the file over: " << std::strerror(errno);
+            response = http_response(response.http_version);
+            response.status_code = http_constants::status::http_internal_server_error;
+        } else {
+            file_message = make_zmq_file_message(fd, response.file_body.offset, response.file_body.length);
+        }
+    }
+
+    ///////////////////////////////////////////////////
+    // 5. Delimit the response and tell the front-end whether the connection persists.
+    //    A streamed message body of unknown length is chunked, or delimited by the end of the connection
+    //    for an HTTP/1.0 client.
+    std::string body_beginning;
+    if (response.body_producer) {
+        const bool length_known = has_content_length(response);
+        body->chunked = !length_known && response.http_version != "HTTP/1.0";
+        if (body->chunked)
+            response.general_header["Transfer-Encoding"] = "chunked";
+        else if (!length_known)
+            keep_alive = false;
+
+        body->producer = std::move(response.body_producer);
+        body_beginning = std::move(response.message_body);
+        response.message_body.clear();
+    } else if (!head_request) {
+        set_content_length(response);
     }
+    response.general_header["Connection"] = keep_alive ? "keep-alive" : "close";
+    transaction.flags = keep_alive ? transaction_t::none : transaction_t::close;
+    if (file_message.size() > 0)
+        transaction.flags |= transaction_t::file_body;
 
     ///////////////////////////////////////////////////
-    // 4. Construct the response and complete the request.
+    // 6. Construct the response, the file follows the serialized response.
 
     std::ostringstream response_builder;
     response_builder << response;
-    const std::string string_response = response_builder.str();
+    if (!body_beginning.empty())
+        response_builder << response_stream::frame_chunk(body_beginning, body->chunked);
+    std::vector<zmq::message_t> parts;
+    parts.push_back(make_zmq_message(response_builder.str()));
+    if (file_message.size() > 0)
+        parts.push_back(std::move(file_message));
 
-    socket.send(&id.identity, id.length, ZMQ_SNDMORE);
-    socket.send(string_response.c_str(), string_response.size());
+    // The message owns the serialized response, the status line is read from it.
+    const char* response_data = static_cast<const char*>(parts.front().data());
+    const std::string line(response_data, std::find(response_data, response_data + parts.front().size(), '\r'));
 
-    std::string line;
-    std::istringstream input(string_response);
-    std::getline(input, line);
     switch (http_constants::get_status_class(response.status_code)) {
         case http_constants::status_class::informational:
         case http_constants::status_class::redirection:
@@ -156,16 +332,73 @@ void http_worker::handle_request(zmq::socket_t& socket)
         default:
             logger::log(logger::type::worker)->error() << line; break;
     }
+
+    return parts;
+}
+
+void http_worker::pump_streams(zmq::socket_t& socket)
+{
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        if (it->pump(socket))
+            it = streams_.erase(it);
+        else
+            ++it;
+    }
+}
+
+generic_file_body http_worker::open_file_body(const file_frame_t& frame)
+{
+    // The front-end releases its own descriptor along with the frame, the resource may keep the body longer.
+    const int fd = ::fcntl(frame.fd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot open the message body of the request");
+
+    generic_file_body body;
+    body.descriptor = std::shared_ptr<const int>(new int(fd), [](const int* descriptor) {
+        ::close(*descriptor);
+        delete descriptor;
+    });
+    body.offset = frame.offset;
+    body.length = frame.length;
+    return body;
+}
+
+bool http_worker::has_content_length(const http_response& response)
+{
+    for (const auto* headers : {&response.entity_header, &response.response_header}) {
+        const auto it = headers->find("Content-Length");
+        if (it != headers->end() && !it->second.empty())
+            return true;
+    }
+    return false;
+}
+
+void http_worker::set_content_length(http_response& response)
+{
+    // A persistent connection relies on the Content-Length to find the end of the response, it is always
+    // the length of the body sent: the one of the resource may describe a representation it did not send.
+    for (auto* headers : {&response.entity_header, &response.response_header})
+        headers->erase("Content-Length");
+
+    // RFC7230 section 3.3.2: a 1xx or 204 response has no Content-Length, and the one of a 304 response
+    // would announce the length of the representation rather than of its empty body.
+    const auto code = static_cast<uint16_t>(response.status_code);
+    if (code < 200 || response.status_code == http_constants::status::http_no_content ||
+        response.status_code == http_constants::status::http_not_modified)
+        return;
+
+    const uint64_t length = response.file_body ? response.file_body.length : response.message_body.size();
+    response.entity_header["Content-Length"] = std::to_string(length);
 }
 
-const http_website& http_worker::find_website(const http_request& request) const
+const http_website& http_worker::find_website(const std::set<http_website>& websites, const http_request_view& request)
 {
     const http_service::host host = http_service::extract_host(request);
 
-    auto iter = std::find(std::cbegin(websites_), std::cend(websites_), host);
-    if (iter == std::cend(websites_)) {
+    auto iter = std::find(std::cbegin(websites), std::cend(websites), host);
+    if (iter == std::cend(websites)) {
         logger::log(logger::type::worker)->warn() << "Unknown website '" << host << "' among: ";
-        for (const auto& website : websites_)
+        for (const auto& website : websites)
             logger::log(logger::type::worker)->warn() << website.host();
         throw http_invalid_request("Unknown website...");
     }
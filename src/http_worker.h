@@ -1,18 +1,60 @@
 #ifndef HTTP_WORKER_H
 #define HTTP_WORKER_H
 
+#include <chrono>
+#include <list>
+#include <memory>
 #include <set>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <zmq.hpp>
 
+#include "codel.h"
+#include "http_server_options.h"
 #include "http_website.h"
+#include "response_stream.h"
 #include "runnable.h"
+#include "transaction.h"
 
 class http_worker : public class_thread
 {
 public:
-    http_worker(zmq::context_t&, size_t, const std::set<http_website>&);
+    /// \brief Constructor of the worker.
+    /// \note A worker connecting to a front-end of another process, over TCP, neither waits for the status
+    ///       of the server nor reports to it: it sends heartbeats instead, and runs until stopped. It only
+    ///       answers with the bytes of the response, neither a file nor a stream.
+    ///
+    /// \param id Identifier of the worker, unique among the workers of the front-end, with
+    ///           http_dispatcher::REMOTE_WORKER for a remote worker.
+    /// \param request_endpoint The endpoint of the front-end, an inproc one for the workers of the server.
+    http_worker(zmq::context_t&, size_t id, const std::set<http_website>&, const std::string& request_endpoint,
+                const http_server_options& options);
+
+    /// \brief Message body of a response streamed after its head, see response_stream.
+    struct streamed_body
+    {
+        response_stream::producer producer;
+        bool chunked;
+    };
+
+    /// \brief Process a request and build its response, as a worker does.
+    /// \note Lets a front-end run the requests to completion on its own thread.
+    ///
+    /// \param websites The websites served, the request is executed by the one matching its host.
+    /// \param identifier Identifier of the calling thread, for the logs.
+    /// \param[in,out] transaction The envelope of the request, updated for the response.
+    /// \param frame The complete request, or its header when its message body was spilled, parsed in place.
+    /// \param request_body The file holding the message body spilled by the front-end, nullptr when the
+    ///                     message body follows the header in the frame.
+    /// \param[out] body Receives the producer of the rest of the message body when it is streamed, nullptr
+    ///                  to produce the whole message body before returning.
+    /// \returns The serialized response, followed by the file of the message body when the front-end allowed it.
+    static std::vector<zmq::message_t> process(const std::set<http_website>& websites, size_t identifier,
+                                               transaction_t& transaction, std::string&& frame,
+                                               const file_frame_t* request_body = nullptr,
+                                               streamed_body* body = nullptr);
 
 protected:
     void run();
@@ -20,13 +62,34 @@ protected:
 private:
     void handle_status(zmq::socket_t&);
     void handle_request(zmq::socket_t&);
+    void pump_streams(zmq::socket_t&);
+
+    static const http_website& find_website(const std::set<http_website>&, const http_request_view&);
+
+    static generic_file_body open_file_body(const file_frame_t&);
 
-    const http_website& find_website(const http_request&) const;
+    static bool has_content_length(const http_response&);
+    static void set_content_length(http_response&);
 
     zmq::context_t& main_context_;
 
     const std::atomic<size_t> identifier_;
     const std::set<http_website>& websites_;
+    const std::string request_endpoint_;
+    const http_server_options::dispatch dispatch_mode_;
+    const std::chrono::seconds retry_after_;
+
+    // The front-end runs in another process, it cannot share the file descriptors or the streams of the worker.
+    const bool remote_;
+    const std::chrono::milliseconds heartbeat_interval_;
+
+    // Sheds the requests which waited too long for the worker, only used by the worker thread.
+    codel codel_;
+
+    // Responses streaming their message body, resumed when the front-end writes their chunks.
+    const size_t stream_window_;
+    std::shared_ptr<response_stream::wakeup> stream_wakeup_;
+    std::list<response_stream> streams_;
 };
 
 #endif
@@ -0,0 +1,93 @@
+#include "http_worker_node.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include "cpu_topology.h"
+#include "http_dispatcher.h"
+#include "http_server.h"
+#include "logger.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+http_server_options node_options(const http_server_options& options)
+{
+    // The front-end addresses the remote workers by their identity.
+    http_server_options node = options;
+    node.dispatch_mode = http_server_options::dispatch::least_loaded;
+    return node;
+}
+
+}
+
+http_worker_node::http_worker_node(const std::string& endpoint, const http_server_options& options /* = http_server_options() */) :
+    endpoint_(endpoint), options_(node_options(options)), context_(options.io_threads), drain_requested_(false)
+{
+    if (endpoint_.compare(0, 9, "inproc://") == 0)
+        throw std::invalid_argument("Invalid front-end endpoint, a worker node connects to another process.");
+}
+
+void http_worker_node::connect(const std::string& website_path, const std::string& host_name,
+                               const uint16_t port /* = 80 */, const std::string& website_name /* = "" */)
+{
+    if (!boost::filesystem::exists(website_path))
+        throw std::invalid_argument("Invalid website root directory. The directory must exist on the filesystem.");
+
+    if (!websites_.emplace(website_path, http_service::host{host_name, port}, website_name).second)
+        throw std::invalid_argument("Invalid website identifier. Is the port and name combination already used ?");
+}
+
+void http_worker_node::run()
+{
+    // 1. The identifiers of the workers must not collide with those of the other nodes of the front-end, which
+    //    hands out the one of the node. The registration is sent again until the front-end answers.
+    logger::log(logger::type::server)->info() << "Registering with the front-end " << endpoint_ << "...";
+    uint32_t node_identifier;
+    {
+        zmq::socket_t socket(context_, zmq::socket_type::dealer);
+        const int linger = 0;
+        socket.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+        socket.connect(endpoint_);
+        do {
+            if (drain_requested_ || http_server::drain_signaled()) {
+                logger::log(logger::type::server)->info() << "Worker node stopped before its registration.";
+                return;
+            }
+            http_dispatcher::register_node(socket);
+        } while (!http_dispatcher::receive_node(socket, node_identifier, static_cast<long>(options_.heartbeat_interval.count())));
+    }
+
+    // 2. Start the workers.
+    const size_t workers = (options_.workers != http_server_options::auto_workers)
+                           ? options_.workers : cpu_topology::usable_cpus();
+
+    logger::log(logger::type::server)->info() << "Connecting " << workers << " worker(s) of node #" << (node_identifier >> 16) << " to the front-end...";
+    for (size_t i = 0; i < std::min<size_t>(workers, 0x10000); ++i) {
+        const uint32_t identifier = http_dispatcher::REMOTE_WORKER | node_identifier | static_cast<uint32_t>(i);
+        workers_.emplace_front(context_, identifier, websites_, endpoint_, options_);
+        workers_.front().start();
+    }
+
+    while (!drain_requested_ && !http_server::drain_signaled())
+        std::this_thread::sleep_for(100ms);
+
+    // 3. Every worker finishes its request in progress, then leaves the front-end.
+    logger::log(logger::type::server)->info() << "Stopping the worker node...";
+    for (auto& worker : workers_)
+        worker.stop();
+    workers_.clear();
+
+    logger::log(logger::type::server)->info() << "Worker node shut down.";
+}
+
+void http_worker_node::drain() noexcept
+{
+    drain_requested_ = true;
+}
@@ -0,0 +1,58 @@
+#ifndef HTTP_WORKER_NODE_H
+#define HTTP_WORKER_NODE_H
+
+#include <atomic>
+#include <cstdint>
+#include <forward_list>
+#include <set>
+#include <string>
+
+#include <zmq.hpp>
+
+#include "http_server_options.h"
+#include "http_website.h"
+#include "http_worker.h"
+
+/// \brief Standalone process of workers serving the requests of a front-end running in another process or host.
+///
+/// The workers of the node connect to the http_server_options::remote_workers_endpoint of the front-end and
+/// announce themselves as remote workers. The front-end balances its requests between its own workers and
+/// those of every node by their load, and drops a node once its heartbeats stop. The node loads the same
+/// websites as the front-end, which only routes the requests to it.
+/// \note Several nodes can run on the same host as the front-end, connected to a loopback endpoint.
+class http_worker_node
+{
+public:
+    /// \brief Constructor of the node.
+    ///
+    /// \param endpoint The endpoint of the front-end, such as tcp://frontend:5570.
+    /// \param options Settings of the workers, for their number and the interval of their heartbeats, which
+    ///                must match the settings of the front-end.
+    explicit http_worker_node(const std::string& endpoint, const http_server_options& options = http_server_options());
+
+    http_worker_node(const http_worker_node&) = delete;
+    http_worker_node& operator=(const http_worker_node&) = delete;
+
+    /// \brief Load a website served by the front-end, see http_server::connect.
+    void connect(const std::string& website_path, const std::string& host_name, const uint16_t port = 80,
+                 const std::string& website_name = "");
+
+    /// \brief Run the workers until the node is drained, each finishing its request in progress.
+    void run();
+
+    /// \brief Stop the node, as do the signals handled by http_server::drain_on_signal.
+    /// \note Can be called from any thread.
+    void drain() noexcept;
+
+private:
+    const std::string endpoint_;
+    const http_server_options options_;
+
+    zmq::context_t context_;
+    std::set<http_website> websites_;
+    std::forward_list<http_worker> workers_;
+
+    std::atomic<bool> drain_requested_;
+};
+
+#endif
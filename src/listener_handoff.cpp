@@ -0,0 +1,230 @@
+#include "listener_handoff.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+namespace
+{
+
+// Most descriptors a single SCM_RIGHTS message carries on Linux (SCM_MAX_FD).
+constexpr size_t MAX_LISTENERS = 253;
+
+// Time allowed to the other process to answer, so that a stuck process never blocks the server.
+constexpr time_t HANDOFF_TIMEOUT_S = 10;
+
+sockaddr_un make_address(const std::string& path)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("Invalid handoff path, it must fit in a Unix socket address.");
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return address;
+}
+
+void set_timeout(int fd)
+{
+    timeval timeout;
+    timeout.tv_sec = HANDOFF_TIMEOUT_S;
+    timeout.tv_usec = 0;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+}
+
+listener_handoff::listener_handoff(const std::string& path) noexcept :
+    path_(path), previous_(-1), listener_(-1)
+{
+}
+
+listener_handoff::~listener_handoff()
+{
+    if (previous_ >= 0)
+        ::close(previous_);
+    if (listener_ >= 0)
+        ::close(listener_);
+}
+
+std::multimap<uint16_t, int> listener_handoff::inherit()
+{
+    std::multimap<uint16_t, int> inherited;
+    const sockaddr_un address = make_address(path_);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot create the handoff socket");
+
+    // Without any server running on the path, this process is the first one.
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        const int error = errno;
+        ::close(fd);
+        if (error == ENOENT || error == ECONNREFUSED)
+            return inherited;
+        throw std::system_error(error, std::system_category(), "Cannot connect to the running server");
+    }
+    set_timeout(fd);
+
+    // 1. The message holds the number of sockets followed by their ports, the sockets themselves are ancillary data.
+    uint32_t count = 0;
+    uint16_t ports[MAX_LISTENERS];
+    char payload[sizeof(count) + sizeof(ports)];
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_LISTENERS)];
+
+    iovec data{payload, sizeof(payload)};
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received = ::recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+    if (received < 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::system_category(), "Cannot receive the listening sockets");
+    }
+
+    // 2. Take ownership of every socket received, whatever happens next.
+    std::vector<int> fds;
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+            continue;
+        const size_t header_count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const int* header_fds = reinterpret_cast<const int*>(CMSG_DATA(header));
+        fds.insert(fds.end(), header_fds, header_fds + header_count);
+    }
+
+    // 3. The rest of the ports may arrive separately on a stream socket.
+    if (received >= static_cast<ssize_t>(sizeof(count)))
+        std::memcpy(&count, payload, sizeof(count));
+    const size_t expected = sizeof(count) + sizeof(uint16_t) * std::min<size_t>(count, MAX_LISTENERS);
+    while (received > 0 && static_cast<size_t>(received) < expected) {
+        const ssize_t more = ::recv(fd, payload + received, expected - static_cast<size_t>(received), 0);
+        if (more < 0 && errno == EINTR)
+            continue;
+        received = (more > 0) ? received + more : -1;
+    }
+
+    if (received < 0 || static_cast<size_t>(received) < expected || count != fds.size() || (message.msg_flags & MSG_CTRUNC)) {
+        for (int listener : fds)
+            ::close(listener);
+        ::close(fd);
+        throw std::runtime_error("Invalid handoff message from the running server.");
+    }
+
+    std::memcpy(ports, payload + sizeof(count), sizeof(uint16_t) * count);
+    for (size_t i = 0; i < count; ++i)
+        inherited.emplace(ports[i], fds[i]);
+
+    previous_ = fd;
+    logger::log(logger::type::server)->info() << "Inherited " << count << " listening socket(s) from the running server.";
+    return inherited;
+}
+
+void listener_handoff::release_previous() noexcept
+{
+    if (previous_ < 0)
+        return;
+
+    const char ready = 1;
+    if (::send(previous_, &ready, sizeof(ready), MSG_NOSIGNAL) != sizeof(ready))
+        logger::log(logger::type::server)->warn() << "Cannot release the previous server: " << std::strerror(errno);
+    ::close(previous_);
+    previous_ = -1;
+}
+
+void listener_handoff::listen()
+{
+    const sockaddr_un address = make_address(path_);
+
+    // The previous server keeps its socket, only the path moves to this one.
+    ::unlink(path_.c_str());
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot create the handoff socket");
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, 1) < 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::system_category(), "Cannot listen on the handoff path " + path_);
+    }
+    listener_ = fd;
+}
+
+bool listener_handoff::serve(const std::vector<listener>& listeners, std::chrono::milliseconds wait)
+{
+    pollfd item{listener_, POLLIN, 0};
+    if (listener_ < 0 || ::poll(&item, 1, static_cast<int>(wait.count())) <= 0)
+        return false;
+
+    const int fd = ::accept4(listener_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0)
+        return false;
+    set_timeout(fd);
+
+    if (listeners.size() > MAX_LISTENERS) {
+        logger::log(logger::type::server)->error() << "Cannot hand over " << listeners.size() << " listening sockets, at most " << MAX_LISTENERS << " are supported.";
+        ::close(fd);
+        return false;
+    }
+
+    // 1. Send the number of sockets and their ports, with the sockets as ancillary data.
+    const uint32_t count = static_cast<uint32_t>(listeners.size());
+    char payload[sizeof(count) + sizeof(uint16_t) * MAX_LISTENERS];
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_LISTENERS)];
+    std::memcpy(payload, &count, sizeof(count));
+    for (size_t i = 0; i < listeners.size(); ++i)
+        std::memcpy(payload + sizeof(count) + sizeof(uint16_t) * i, &listeners[i].first, sizeof(uint16_t));
+
+    iovec data{payload, sizeof(count) + sizeof(uint16_t) * count};
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    if (count > 0) {
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        int* header_fds = reinterpret_cast<int*>(CMSG_DATA(header));
+        for (size_t i = 0; i < listeners.size(); ++i)
+            header_fds[i] = listeners[i].second;
+    }
+
+    if (::sendmsg(fd, &message, MSG_NOSIGNAL) < 0) {
+        logger::log(logger::type::server)->warn() << "Cannot hand over the listening sockets: " << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    // 2. Keep serving until the next process confirms it serves the sockets, it may fail to start.
+    char ready = 0;
+    ssize_t received;
+    do {
+        received = ::recv(fd, &ready, sizeof(ready), 0);
+    } while (received < 0 && errno == EINTR);
+    ::close(fd);
+
+    if (received != sizeof(ready)) {
+        logger::log(logger::type::server)->warn() << "The next server did not take over the listening sockets, still serving them.";
+        return false;
+    }
+    logger::log(logger::type::server)->info() << "Handed " << count << " listening socket(s) over to the next server.";
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef LISTENER_HANDOFF_H
+#define LISTENER_HANDOFF_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// \brief Hand the listening sockets of a running server over to the process replacing it, through a Unix socket.
+///
+/// The new process asks the running one for its listening sockets, which are passed as SCM_RIGHTS ancillary
+/// data along with their port. Both processes then accept from the same sockets: the kernel keeps queuing the
+/// connections on them during the whole upgrade. Once the new process serves them, it releases the previous
+/// one, which drains, and waits on the same path for the process replacing it in turn.
+class listener_handoff
+{
+public:
+    using listener = std::pair<uint16_t, int>;
+
+    /// \brief Constructor of the handoff.
+    ///
+    /// \param path Path of the Unix socket the running server waits on.
+    explicit listener_handoff(const std::string& path) noexcept;
+    ~listener_handoff();
+
+    listener_handoff(const listener_handoff&) = delete;
+    listener_handoff& operator=(const listener_handoff&) = delete;
+
+    /// \brief Ask the server running on the path for its listening sockets.
+    /// \note The previous server keeps serving until release_previous is called.
+    ///
+    /// \returns The listening sockets received, keyed by port, none when no server is running on the path.
+    /// \throws std::system_error if the running server cannot hand its sockets over.
+    std::multimap<uint16_t, int> inherit();
+
+    /// \brief Let the previous server drain, once the inherited sockets are served.
+    void release_previous() noexcept;
+
+    /// \brief Start waiting on the path for the next process, replacing a stale socket file.
+    /// \throws std::system_error if the path cannot be bound.
+    void listen();
+
+    /// \brief Wait for the next process, and hand it the listening sockets.
+    ///
+    /// \param listeners The listening sockets with their port.
+    /// \param wait Time to wait for the next process.
+    /// \returns True once the next process serves the sockets, the server must then drain.
+    bool serve(const std::vector<listener>& listeners, std::chrono::milliseconds wait);
+
+private:
+    const std::string path_;
+    int previous_;
+    int listener_;
+};
+
+#endif
@@ -1,4 +1,7 @@
 #include "http_server.h"
+#include "http_worker_node.h"
+
+#include <cstring>
 
 #include <spdlog/spdlog.h>
 
@@ -20,9 +23,26 @@ int main(int argc, char* argv[])
     server_log->emerg() << "color test";
     std::cout << std::endl;
 
-    http_server server;
-    void connect(const std::string& website_path, const std::string& host, uint16_t port = 80, const std::string& website_name = "");
+    // Stopping the process lets the requests in progress complete.
+    http_server::drain_on_signal(SIGTERM);
+    http_server::drain_on_signal(SIGINT);
+
+    // --worker <endpoint> runs the workers of a front-end started with --remote-workers <endpoint>.
+    if (argc == 3 && std::strcmp(argv[1], "--worker") == 0) {
+        http_worker_node node(argv[2]);
+        node.connect("hello_world", "localhost", 8081);
+        node.connect("example/rest_webservice.dll", "localhost", 8082);
+        node.run();
+        return 0;
+    }
+
+    http_server_options options;
+    if (argc == 3 && std::strcmp(argv[1], "--remote-workers") == 0) {
+        options.dispatch_mode = http_server_options::dispatch::least_loaded;
+        options.remote_workers_endpoint = argv[2];
+    }
 
+    http_server server(options);
     server.connect("hello_world", "localhost", 8081);
     server.connect("example/rest_webservice.dll", "localhost", 8082);
     server.run();
@@ -0,0 +1,275 @@
+#include "prefork_master.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "http_reactor.h"
+#include "http_server.h"
+#include "logger.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+constexpr auto SUPERVISE_INTERVAL = 100ms;
+
+// A process exiting sooner after its start is replaced after this delay, a process crashing as it starts
+// must not keep the master forking.
+constexpr auto RESPAWN_DELAY = 1s;
+
+// Time the processes are given past their drain timeout before they are killed.
+constexpr auto STOP_GRACE = 5s;
+
+std::string describe_exit(int status)
+{
+    std::ostringstream description;
+    if (WIFEXITED(status))
+        description << "exited with status " << WEXITSTATUS(status);
+    else if (WIFSIGNALED(status))
+        description << "was killed by signal " << WTERMSIG(status) << " (" << ::strsignal(WTERMSIG(status)) << ")";
+    else
+        description << "stopped";
+    return description.str();
+}
+
+}
+
+prefork_master::prefork_master(size_t processes, const http_server_options& options /* = http_server_options() */) :
+    options_(options), slots_(processes)
+{
+    if (processes == 0)
+        throw std::invalid_argument("Invalid number of processes, at least one is required.");
+    if (options_.front_end == http_server_options::engine::zmq_stream)
+        throw std::invalid_argument("Sharing the listening sockets between processes requires a reactor engine.");
+    if (!options_.handoff_path.empty())
+        throw std::invalid_argument("Handing the listening sockets over is not supported with several processes.");
+    if (options_.shards == 0)
+        throw std::invalid_argument("Invalid number of shards, at least one is required.");
+
+    for (auto& s : slots_)
+        s.pid = -1;
+}
+
+prefork_master::~prefork_master()
+{
+    for (auto& s : slots_)
+        close_listeners(s);
+}
+
+void prefork_master::connect(const std::string& website_path, const std::string& host_name,
+                             const uint16_t port /* = 80 */, const std::string& website_name /* = "" */,
+                             const size_t max_in_flight /* = 0 */)
+{
+    // The processes connect the website once forked, a website they cannot load is reported right away.
+    if (!boost::filesystem::exists(website_path))
+        throw std::invalid_argument("Invalid website root directory. The directory must exist on the filesystem.");
+
+    const bool bound = std::any_of(websites_.cbegin(), websites_.cend(),
+                                   [port](const website& w) { return w.port == port; });
+    websites_.push_back(website{website_path, host_name, port, website_name, max_in_flight});
+    if (bound)
+        return;
+
+    // Every shard of every process has its own socket in the SO_REUSEPORT group of the port.
+    try {
+        for (auto& s : slots_)
+            open_listeners(s, port);
+    } catch (std::exception&) {
+        for (auto& s : slots_)
+            close_listeners(s, port);
+        websites_.pop_back();
+        throw;
+    }
+}
+
+void prefork_master::run()
+{
+    logger::log(logger::type::server)->info() << "Forking " << slots_.size() << " server process(es)...";
+    for (size_t i = 0; i < slots_.size(); ++i)
+        spawn(i);
+
+    bool stopping = false;
+    auto stop_deadline = std::chrono::steady_clock::time_point::max();
+    while (true) {
+        const auto now = std::chrono::steady_clock::now();
+
+        // 1. Stop the processes once the master is stopped, killing those still running past their drain.
+        if (!stopping && http_server::drain_signaled()) {
+            stopping = true;
+            stop_deadline = now + options_.drain_timeout + STOP_GRACE;
+            stop(stop_deadline);
+        } else if (stopping && now >= stop_deadline) {
+            for (const auto& s : slots_) {
+                if (s.pid > 0) {
+                    logger::log(logger::type::server)->warn() << "Server process " << s.pid << " did not drain in time, killing it.";
+                    ::kill(s.pid, SIGKILL);
+                }
+            }
+            stop_deadline = std::chrono::steady_clock::time_point::max();
+        }
+
+        // 2. Replace the processes which exited, once their delay passed.
+        for (size_t i = 0; i < slots_.size() && !stopping; ++i) {
+            if (slots_[i].pid < 0 && now >= slots_[i].respawn)
+                spawn(i);
+        }
+
+        // 3. Collect the processes which exited.
+        int status;
+        const pid_t pid = ::waitpid(-1, &status, WNOHANG);
+        if (pid < 0 && errno == EINTR)
+            continue;
+        if (pid < 0 && errno != ECHILD)
+            throw std::system_error(errno, std::system_category(), "Cannot wait for the server processes");
+        if (pid <= 0) {
+            if (stopping && pid < 0)
+                break;
+            std::this_thread::sleep_for(SUPERVISE_INTERVAL);
+            continue;
+        }
+
+        const auto slot_it = std::find_if(slots_.begin(), slots_.end(), [pid](const slot& s) { return s.pid == pid; });
+        if (slot_it == slots_.end())
+            continue;
+        slot_it->pid = -1;
+        slot_it->respawn = std::max(now, slot_it->started + RESPAWN_DELAY);
+
+        // The kernel would keep queuing connections on the sockets of the slot until it is replaced, they are
+        // closed for the other processes to get them, the replacement opens new ones.
+        close_listeners(*slot_it);
+
+        if (stopping) {
+            logger::log(logger::type::server)->info() << "Server process " << pid << " " << describe_exit(status) << ".";
+        } else {
+            logger::log(logger::type::server)->error() << "Server process " << pid << " " << describe_exit(status)
+                                                       << ", replacing it.";
+        }
+    }
+
+    logger::log(logger::type::server)->info() << "Every server process exited.";
+}
+
+void prefork_master::spawn(size_t index)
+{
+    slot& s = slots_[index];
+    const auto now = std::chrono::steady_clock::now();
+
+    // The sockets of the process it replaces were closed as it exited.
+    if (s.listeners.empty()) {
+        try {
+            for (auto website_it = websites_.cbegin(); website_it != websites_.cend(); ++website_it) {
+                const uint16_t port = website_it->port;
+                if (std::none_of(websites_.cbegin(), website_it, [port](const website& w) { return w.port == port; }))
+                    open_listeners(s, port);
+            }
+        } catch (std::exception& e) {
+            logger::log(logger::type::server)->error() << "Cannot open the sockets of server process #" << index << ": " << e.what();
+            close_listeners(s);
+            s.respawn = now + RESPAWN_DELAY;
+            return;
+        }
+    }
+
+    // The buffered output would otherwise be written by both processes.
+    std::cout.flush();
+    std::fflush(nullptr);
+
+    const pid_t master = ::getpid();
+    const pid_t pid = ::fork();
+    if (pid == 0)
+        ::_exit(serve(index, master));
+
+    if (pid < 0) {
+        logger::log(logger::type::server)->error() << "Cannot fork server process #" << index << ": " << std::strerror(errno);
+        s.respawn = now + RESPAWN_DELAY;
+        return;
+    }
+
+    s.pid = pid;
+    s.started = now;
+    logger::log(logger::type::server)->info() << "Server process #" << index << " started, pid " << pid << ".";
+}
+
+int prefork_master::serve(size_t index, pid_t master) noexcept
+{
+    // 1. The process stops along with the master, which may have exited before it asked to.
+    ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (::getppid() != master)
+        return EXIT_FAILURE;
+
+    // Only the sockets of the slot are kept.
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (i == index)
+            continue;
+        for (const auto& listener : slots_[i].listeners)
+            ::close(listener.second);
+        slots_[i].listeners.clear();
+    }
+
+    // 2. Run a whole server on the sockets of the slot.
+    try {
+        http_server server(options_);
+        for (const auto& listener : slots_[index].listeners)
+            server.inherit(listener.first, listener.second);
+
+        for (const auto& w : websites_)
+            server.connect(w.path, w.host_name, w.port, w.name, w.max_in_flight);
+        server.run();
+    } catch (std::exception& e) {
+        logger::log(logger::type::server)->error() << "Server process #" << index << " failed: " << e.what();
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+void prefork_master::open_listeners(slot& s, uint16_t port)
+{
+    for (size_t shard = 0; shard < options_.shards; ++shard)
+        s.listeners.emplace_back(port, http_reactor::open_listener(port, true));
+}
+
+void prefork_master::close_listeners(slot& s, uint16_t port) noexcept
+{
+    auto listener_it = s.listeners.begin();
+    while (listener_it != s.listeners.end()) {
+        if (listener_it->first == port) {
+            ::close(listener_it->second);
+            listener_it = s.listeners.erase(listener_it);
+        } else {
+            ++listener_it;
+        }
+    }
+}
+
+void prefork_master::close_listeners(slot& s) noexcept
+{
+    for (const auto& listener : s.listeners)
+        ::close(listener.second);
+    s.listeners.clear();
+}
+
+void prefork_master::stop(std::chrono::steady_clock::time_point deadline)
+{
+    const auto remaining = std::chrono::duration_cast<std::chrono::seconds>(deadline - std::chrono::steady_clock::now());
+    logger::log(logger::type::server)->info() << "Stopping the server processes, killing them in " << remaining.count() << " s at the latest.";
+    for (const auto& s : slots_) {
+        if (s.pid > 0)
+            ::kill(s.pid, SIGTERM);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef PREFORK_MASTER_H
+#define PREFORK_MASTER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "http_server_options.h"
+
+/// \brief Master process of a pool of server processes sharing the listening sockets.
+///
+/// The master binds the ports of the websites connected to it, then forks the server processes, each running
+/// a whole http_server on the sockets of its slot: every process has its own sockets in the SO_REUSEPORT group
+/// of each port, one per shard, and the kernel balances the connections between them. A website, its
+/// allocator and its locks are thus only shared by the requests of a process, and a process crashing only
+/// loses its own connections. The master supervises the processes and forks a new one in the slot of every
+/// process exiting. The sockets of the slot are closed as the process exits, for the kernel to balance the new
+/// connections between the processes left, and opened again for its replacement.
+///
+/// The master stops on the signals handled by http_server::drain_on_signal: it forwards SIGTERM to the
+/// processes, which drain, and waits for them.
+/// \note The master never creates a zmq context, the processes create their own once forked. Each process
+///       sizes its workers on its own, set http_server_options::workers explicitly to share the cores.
+class prefork_master
+{
+public:
+    /// \brief Constructor of the master.
+    ///
+    /// \param processes Number of server processes, at least one.
+    /// \param options Settings of the server of every process, with a reactor engine.
+    /// \throws std::invalid_argument if the settings cannot be shared by several processes.
+    prefork_master(size_t processes, const http_server_options& options = http_server_options());
+    ~prefork_master();
+
+    prefork_master(const prefork_master&) = delete;
+    prefork_master& operator=(const prefork_master&) = delete;
+
+    /// \brief Bind the port of a website, connected to the server of every process, see http_server::connect.
+    void connect(const std::string& website_path, const std::string& host_name, const uint16_t port = 80,
+                 const std::string& website_name = "", const size_t max_in_flight = 0);
+
+    /// \brief Fork the server processes and supervise them until the master is stopped.
+    /// \note Returns in the master only, once every process exited.
+    void run();
+
+private:
+    struct website
+    {
+        std::string path;
+        std::string host_name;
+        uint16_t    port;
+        std::string name;
+        size_t      max_in_flight;
+    };
+
+    struct slot
+    {
+        pid_t pid; ///< The process serving the slot, or -1 until it is replaced.
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point respawn;
+        std::vector<std::pair<uint16_t, int>> listeners;
+    };
+
+    void spawn(size_t index);
+    void open_listeners(slot& s, uint16_t port);
+    static void close_listeners(slot& s, uint16_t port) noexcept;
+    static void close_listeners(slot& s) noexcept;
+    int serve(size_t index, pid_t master) noexcept;
+    void stop(std::chrono::steady_clock::time_point deadline);
+
+    const http_server_options options_;
+    std::vector<website> websites_;
+    std::vector<slot> slots_;
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "response_stream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <sstream>
+#include <system_error>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "http_constants.h"
+#include "logger.h"
+
+struct response_stream::window
+{
+    std::atomic<size_t> in_flight;
+    std::atomic<bool> blocked;   ///< The producer waits for the front-end, which must wake the worker up.
+    std::atomic<bool> cancelled;
+    const size_t low_water;
+    const std::shared_ptr<wakeup> waker;
+
+    window(size_t low_water, std::shared_ptr<wakeup> waker) :
+        in_flight(0), blocked(false), cancelled(false), low_water(low_water), waker(std::move(waker)) {}
+
+    void release(size_t length) noexcept
+    {
+        // The worker is woken up once half of the window is free, not for every message written.
+        const size_t previous = in_flight.fetch_sub(length);
+        if (previous - length < low_water && blocked.exchange(false))
+            waker->notify();
+    }
+};
+
+struct response_stream::chunk
+{
+    std::string content;
+    std::shared_ptr<window> owner;
+};
+
+response_stream::wakeup::wakeup() :
+    fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (fd_ < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot create the stream event descriptor");
+}
+
+response_stream::wakeup::~wakeup()
+{
+    ::close(fd_);
+}
+
+void response_stream::wakeup::notify() noexcept
+{
+    const uint64_t one = 1;
+    ssize_t written;
+    do {
+        written = ::write(fd_, &one, sizeof(one));
+    } while (written < 0 && errno == EINTR);
+}
+
+void response_stream::wakeup::clear() noexcept
+{
+    uint64_t count;
+    ssize_t received;
+    do {
+        received = ::read(fd_, &count, sizeof(count));
+    } while (received < 0 && errno == EINTR);
+}
+
+response_stream::response_stream(const identity_t& id, const transaction_t& transaction, std::vector<zmq::message_t>&& head,
+                                 producer&& body, bool chunked, std::shared_ptr<wakeup> waker, size_t window) :
+    id_(id), transaction_(transaction), head_(std::move(head)), body_(std::move(body)), chunked_(chunked),
+    finished_(false), limit_(std::max<size_t>(1, window)),
+    window_(std::make_shared<response_stream::window>(limit_ / 2, std::move(waker)))
+{
+    // The front-end hands the token back to cancel the stream, the messages in flight keep the window alive.
+    transaction_.stream = reinterpret_cast<uintptr_t>(window_.get());
+}
+
+bool response_stream::pump(zmq::socket_t& socket)
+{
+    // 1. The head leaves as soon as the stream starts. Like the chunks, it keeps the window alive while the
+    //    front-end holds it, so that the front-end can cancel the stream with any message but the last one.
+    for (const auto& part : head_) {
+        zmq::message_t held = make_chunk_message(std::string(static_cast<const char*>(part.data()), part.size()));
+        send(socket, held, false);
+    }
+    head_.clear();
+
+    while (!finished_) {
+        // 2. The connection is gone, the last message only releases the request in the front-end.
+        if (window_->cancelled) {
+            zmq::message_t last;
+            send(socket, last, true);
+            break;
+        }
+
+        // 3. Wait for the front-end while the window is full, the release may have happened in the meantime.
+        if (window_->in_flight >= limit_) {
+            window_->blocked = true;
+            if (window_->in_flight >= limit_ && !window_->cancelled)
+                return false;
+            window_->blocked = false;
+            continue;
+        }
+
+        // 4. Produce the next chunk, the last message of the response ends the message body.
+        std::string data;
+        bool more;
+        try {
+            more = body_(data);
+        } catch (std::exception& e) {
+            // The message body cannot be completed, the connection is closed to let the client know.
+            logger::log(logger::type::worker)->error() << "Exception while streaming the response: " << e.what();
+            transaction_.flags |= transaction_t::close;
+            zmq::message_t last;
+            send(socket, last, true);
+            break;
+        }
+
+        if (!data.empty()) {
+            zmq::message_t part = make_chunk_message(frame_chunk(data, chunked_));
+            send(socket, part, false);
+        }
+        if (!more) {
+            zmq::message_t last = chunked_ ? make_chunk_message("0" + std::string(http_constants::CRLF) + http_constants::CRLF)
+                                           : zmq::message_t();
+            send(socket, last, true);
+        }
+    }
+
+    finished_ = true;
+    return true;
+}
+
+std::string response_stream::frame_chunk(const std::string& data, bool chunked)
+{
+    if (!chunked)
+        return data;
+
+    std::ostringstream chunk_builder;
+    chunk_builder << std::hex << data.size() << http_constants::CRLF << data << http_constants::CRLF;
+    return chunk_builder.str();
+}
+
+void response_stream::cancel(const transaction_t& transaction) noexcept
+{
+    if (transaction.stream == 0)
+        return;
+
+    window* stream_window = reinterpret_cast<window*>(static_cast<uintptr_t>(transaction.stream));
+    stream_window->cancelled = true;
+    if (stream_window->blocked.exchange(false))
+        stream_window->waker->notify();
+}
+
+void response_stream::send(zmq::socket_t& socket, zmq::message_t& part, bool last)
+{
+    // Every message carries the envelope, the front-end completes the response with the last one.
+    transaction_t transaction = transaction_;
+    if (!last)
+        transaction.flags |= transaction_t::partial;
+
+    socket.send(&id_.identity, id_.length, ZMQ_SNDMORE);
+    socket.send(&transaction, sizeof(transaction), ZMQ_SNDMORE);
+    socket.send(part);
+    if (last)
+        finished_ = true;
+}
+
+zmq::message_t response_stream::make_chunk_message(std::string&& content)
+{
+    // The bytes are accounted until the front-end releases the message, once written to the client.
+    const size_t length = content.size();
+    chunk* owned_chunk = new chunk{std::move(content), window_};
+    window_->in_flight += length;
+    return zmq::message_t(&owned_chunk->content[0], length,
+                          [](void*, void* hint) {
+                              chunk* released = static_cast<chunk*>(hint);
+                              released->owner->release(released->content.size());
+                              delete released;
+                          }, owned_chunk);
+}
@@ -0,0 +1,104 @@
+#ifndef RESPONSE_STREAM_H
+#define RESPONSE_STREAM_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include "identity.h"
+#include "transaction.h"
+
+/// \brief Response whose message body is produced incrementally by its resource, sent by a worker as a series
+///        of messages as the chunks are produced.
+///
+/// The chunks are sent with Transfer-Encoding: chunked, or as raw bytes delimited by the end of the connection
+/// for an HTTP/1.0 client. Every message of the stream carries transaction_t::partial but the last one, and the
+/// front-end writes them as they come once the response is released. The bytes of the messages not written
+/// yet are accounted in the window of the stream: its producer is not asked for more while the window is full,
+/// and the worker is woken up through an event descriptor once the front-end wrote enough of them.
+class response_stream
+{
+public:
+    /// \brief Fills the next chunk of the message body, returns false once the body is complete.
+    using producer = std::function<bool(std::string& chunk)>;
+
+    /// \brief Event descriptor waking a worker up when one of its streams has room again.
+    class wakeup
+    {
+    public:
+        /// \throws std::system_error if the event descriptor cannot be created.
+        wakeup();
+        ~wakeup();
+
+        wakeup(const wakeup&) = delete;
+        wakeup& operator=(const wakeup&) = delete;
+
+        /// \brief Descriptor becoming readable once notified.
+        int descriptor() const noexcept { return fd_; }
+
+        /// \brief Wake the worker up, from any thread.
+        void notify() noexcept;
+
+        /// \brief Acknowledge the notifications received so far.
+        void clear() noexcept;
+
+    private:
+        int fd_;
+    };
+
+    /// \brief Constructor of the stream.
+    ///
+    /// \param id The identity of the connection the response belongs to.
+    /// \param transaction The envelope of the response.
+    /// \param head The frames of the serialized response, sent ahead of the chunks.
+    /// \param body Producer of the rest of the message body.
+    /// \param chunked True to frame the chunks with the chunked transfer-coding.
+    /// \param waker Notified when the stream has room again.
+    /// \param window Bytes of the stream sent and not written to the client yet, past which the producer waits.
+    response_stream(const identity_t& id, const transaction_t& transaction, std::vector<zmq::message_t>&& head,
+                    producer&& body, bool chunked, std::shared_ptr<wakeup> waker, size_t window);
+
+    response_stream(response_stream&&) = default;
+
+    /// \brief Send the frames of the response while its window has room.
+    ///
+    /// \param socket The request socket of the worker.
+    /// \returns True once the last message of the response is sent.
+    bool pump(zmq::socket_t& socket);
+
+    /// \brief Frame a chunk of a message body.
+    ///
+    /// \param data The bytes of the chunk, not empty.
+    /// \param chunked True to frame the chunk with the chunked transfer-coding.
+    static std::string frame_chunk(const std::string& data, bool chunked);
+
+    /// \brief Stop the stream of a message the front-end drops, as its connection was closed.
+    /// \note Must be called while the message is still held, the stream is released with its last message.
+    ///       Only the local workers stream their responses, the dispatcher refuses a partial response of a
+    ///       remote worker and clears its stream token.
+    static void cancel(const transaction_t& transaction) noexcept;
+
+private:
+    struct window;
+    struct chunk;
+
+    void send(zmq::socket_t& socket, zmq::message_t& part, bool last);
+    zmq::message_t make_chunk_message(std::string&& content);
+
+    const identity_t id_;
+    transaction_t transaction_;
+    std::vector<zmq::message_t> head_;
+    producer body_;
+    bool chunked_;
+    bool finished_;
+    size_t limit_;
+
+    // Shared with the messages in flight, which may outlive the stream.
+    std::shared_ptr<window> window_;
+};
+
+#endif
@@ -5,6 +5,10 @@
 #include <exception>
 #include <thread>
 
+#include <pthread.h>
+#include <signal.h>
+
+#include "cpu_topology.h"
 #include "logger.h"
 
 class class_thread
@@ -28,11 +32,31 @@ public:
 
     void stop() {
         running = false;
-        thread.join();
+        if (thread.joinable())
+            thread.join();
+    }
+    void wait() {
+        if (thread.joinable())
+            thread.join();
     }
     void start() {
         running = true;
-        thread = std::thread(&class_thread::run, this);
+        // The thread is created with every signal blocked, the signals are left to the threads of the application.
+        sigset_t blocked, previous;
+        ::sigfillset(&blocked);
+        ::pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+        try {
+            thread = std::thread(&class_thread::run, this);
+        } catch (...) {
+            ::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+            throw;
+        }
+        ::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    }
+    /// \brief Restrict the started thread to a single core.
+    /// \returns False if the core is not available to the process.
+    bool pin(int cpu) {
+        return thread.joinable() && cpu_topology::pin(thread.native_handle(), cpu);
     }
 
 protected:
@@ -0,0 +1,170 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/// \brief Hierarchical timing wheel, scheduling, cancelling and expiring a timer in constant time.
+///
+/// Time is divided in ticks of a fixed resolution. The first level holds the timers due within 64 ticks,
+/// one slot per tick, and every following level covers 64 times the range of the previous one with slots
+/// of 64 times its resolution. As time advances, the timers of a slot of an upper level are moved down
+/// once their slot comes into the range of the level below, so every timer is moved at most once per level.
+/// The timers are embedded in their owner, which they point back to.
+///
+/// \tparam T Type of the owner of the timers.
+template <typename T>
+class timer_wheel
+{
+    struct link
+    {
+        link* prev;
+        link* next;
+
+        link() noexcept : prev(this), next(this) {}
+        link(const link&) = delete;
+        link& operator=(const link&) = delete;
+    };
+
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// \brief Timer embedded in its owner, cancelled when destroyed.
+    class timer : private link
+    {
+    public:
+        explicit timer(T& owner) noexcept : owner_(&owner), expiry_(0) { this->prev = this->next = nullptr; }
+        ~timer() { cancel(); }
+
+        bool scheduled() const noexcept { return this->next != nullptr; }
+
+        void cancel() noexcept
+        {
+            if (!scheduled())
+                return;
+            this->prev->next = this->next;
+            this->next->prev = this->prev;
+            this->prev = this->next = nullptr;
+        }
+
+    private:
+        friend class timer_wheel;
+
+        T* owner_;
+        uint64_t expiry_;
+    };
+
+    /// \brief Constructor of the wheel.
+    ///
+    /// \param resolution Duration of a tick, the timers expire at most one tick late.
+    /// \param now The current time.
+    explicit timer_wheel(clock::duration resolution = std::chrono::milliseconds(10), clock::time_point now = clock::now()) noexcept :
+        resolution_(resolution), origin_(now), current_(0)
+    {
+    }
+
+    ~timer_wheel()
+    {
+        // The timers outliving the wheel must not point to its slots.
+        for (auto& level : slots_) {
+            for (auto& slot : level) {
+                while (slot.next != &slot)
+                    static_cast<timer*>(slot.next)->cancel();
+            }
+        }
+    }
+
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+
+    /// \brief Schedule a timer, or move it if it was already scheduled.
+    /// \note A deadline beyond the range of the wheel expires early, the owner is expected to check its deadline.
+    ///
+    /// \param t The timer.
+    /// \param deadline Time the timer expires, clock::time_point::max() to only cancel it.
+    void schedule(timer& t, clock::time_point deadline) noexcept
+    {
+        t.cancel();
+        if (deadline == clock::time_point::max())
+            return;
+
+        // Round up to the next tick, a timer never expires early.
+        uint64_t expiry = current_ + 1;
+        if (deadline > origin_) {
+            const auto ticks = (deadline - origin_ + resolution_ - clock::duration(1)) / resolution_;
+            expiry = std::max<uint64_t>(expiry, static_cast<uint64_t>(ticks));
+        }
+        t.expiry_ = expiry;
+        insert(t);
+    }
+
+    /// \brief Expire the timers due up to a point in time.
+    ///
+    /// \param now The current time.
+    /// \param on_expired Called with the owner of every expired timer, which is no longer scheduled. It may
+    ///                   schedule the timer again, or destroy its owner.
+    template <typename F>
+    void advance(clock::time_point now, F&& on_expired)
+    {
+        if (now < origin_)
+            return;
+        const uint64_t target = static_cast<uint64_t>((now - origin_) / resolution_);
+
+        while (current_ < target) {
+            ++current_;
+
+            // The slots of the upper levels are moved down when the level below wraps around.
+            for (size_t level = 1; level < LEVELS && (current_ & ((uint64_t(1) << (BITS * level)) - 1)) == 0; ++level) {
+                link& slot = slots_[level][(current_ >> (BITS * level)) & MASK];
+                while (slot.next != &slot) {
+                    timer& t = *static_cast<timer*>(slot.next);
+                    t.cancel();
+                    insert(t);
+                }
+            }
+
+            link& slot = slots_[0][current_ & MASK];
+            while (slot.next != &slot) {
+                timer& t = *static_cast<timer*>(slot.next);
+                t.cancel();
+                on_expired(*t.owner_);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t BITS = 6;
+    static constexpr size_t SLOTS = size_t(1) << BITS;
+    static constexpr uint64_t MASK = SLOTS - 1;
+    static constexpr size_t LEVELS = 4;
+
+    void insert(timer& t) noexcept
+    {
+        // Past the range of the wheel, the timer expires at its end.
+        const uint64_t range = uint64_t(1) << (BITS * LEVELS);
+        if (t.expiry_ - current_ >= range)
+            t.expiry_ = current_ + range - 1;
+
+        const uint64_t delta = t.expiry_ - current_;
+        size_t level = 0;
+        while (level + 1 < LEVELS && delta >= (uint64_t(1) << (BITS * (level + 1))))
+            ++level;
+
+        link& slot = slots_[level][(t.expiry_ >> (BITS * level)) & MASK];
+        t.prev = slot.prev;
+        t.next = &slot;
+        slot.prev->next = &t;
+        slot.prev = &t;
+    }
+
+    const clock::duration resolution_;
+    const clock::time_point origin_;
+    uint64_t current_;
+
+    std::array<std::array<link, SLOTS>, LEVELS> slots_;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include <cstdint>
+
+/// \brief Envelope frame following the identity in every message exchanged with the workers.
+///
+/// The front-end fills the envelope when dispatching a request and the worker sends it back, updated,
+/// along with the response. The sequence lets the front-end restore the order of the responses to the
+/// requests pipelined on a connection, as they are processed in parallel by the workers.
+struct transaction_t
+{
+    enum flags_t : uint8_t {
+        none      = 0,
+        close     = 1 << 0, ///< The connection is closed once the response is written.
+        file_body = 1 << 1, ///< Request: the front-end can send a file_frame_t.
+                            ///< Response: the last frame is a file_frame_t, following the serialized response.
+        partial   = 1 << 2, ///< Response: the response continues in the next messages, see response_stream.
+        body_file = 1 << 3  ///< Request: the last frame is a file_frame_t holding the message body, see
+                            ///< http_server_options::body_spill_threshold.
+    };
+
+    uint32_t sequence;
+    uint8_t  flags;
+    uint16_t admission;  ///< Website the request was admitted on, see http_admission.
+    uint64_t dispatched; ///< Time the front-end dispatched the request, in steady clock nanoseconds.
+    uint64_t stream;     ///< Token of a streamed response, handed back to response_stream::cancel, or 0.
+};
+
+/// \brief Frame standing for a message body left in a file, written by the front-end straight from the page cache.
+/// \note The frame owns the file descriptor, see make_zmq_file_message.
+struct file_frame_t
+{
+    int      fd;
+    uint64_t offset;
+    uint64_t length;
+};
+
+#endif
@@ -1,11 +1,19 @@
 #ifndef ZMQ_UTILITY_HPP
 #define ZMQ_UTILITY_HPP
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <iomanip>
 #include <ios>
 #include <ostream>
+#include <string>
+#include <utility>
+
+#include <unistd.h>
+#include <zmq.hpp>
+
+#include "transaction.h"
 
 template <size_t N>
 struct zmq_identity {
@@ -13,6 +21,19 @@ struct zmq_identity {
 	size_t length;
 };
 
+template <size_t N>
+bool operator==(const zmq_identity<N>& lhs, const zmq_identity<N>& rhs)
+{
+	return lhs.length == rhs.length && std::equal(lhs.identity.cbegin(), lhs.identity.cbegin() + lhs.length, rhs.identity.cbegin());
+}
+
+template <size_t N>
+bool operator<(const zmq_identity<N>& lhs, const zmq_identity<N>& rhs)
+{
+	return std::lexicographical_compare(lhs.identity.cbegin(), lhs.identity.cbegin() + lhs.length,
+	                                    rhs.identity.cbegin(), rhs.identity.cbegin() + rhs.length);
+}
+
 template <size_t N>
 std::ostream& operator<<(std::ostream& stream, const zmq_identity<N>& id)
 {
@@ -34,4 +55,26 @@ std::ostream& operator<<(std::ostream& stream, const zmq_identity<N>& id)
 	return stream;
 }
 
+/// \brief Wrap a string in a zmq message without copying it.
+/// The message takes ownership of the string, which is released by zmq once the message is sent.
+inline zmq::message_t make_zmq_message(std::string&& content)
+{
+	std::string* owned_content = new std::string(std::move(content));
+	return zmq::message_t(&(*owned_content)[0], owned_content->size(),
+	                      [](void*, void* hint) { delete static_cast<std::string*>(hint); }, owned_content);
+}
+
+/// \brief Wrap an open file in a zmq message, for the front-end to send the file in place of the bytes of a message.
+/// The message takes ownership of the file descriptor, which is closed once the message is released.
+inline zmq::message_t make_zmq_file_message(int fd, uint64_t offset, uint64_t length)
+{
+	file_frame_t* frame = new file_frame_t{fd, offset, length};
+	return zmq::message_t(frame, sizeof(file_frame_t),
+	                      [](void* data, void*) {
+	                          file_frame_t* owned_frame = static_cast<file_frame_t*>(data);
+	                          ::close(owned_frame->fd);
+	                          delete owned_frame;
+	                      }, nullptr);
+}
+
 #endif
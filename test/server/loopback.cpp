@@ -0,0 +1,602 @@
+#include "gtest/gtest.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "http_request_framer.h"
+#include "http_server.h"
+#include "http_worker_node.h"
+#include "http_uring_reactor.h"
+
+namespace
+{
+
+// Website of the conformance tests of the library, copied in the working directory.
+constexpr auto WEBSITE = "method_conformance";
+
+struct response
+{
+    int status = 0;
+    std::map<std::string, std::string> header; ///< Keyed by the lowercase name of the headers.
+    std::string body;
+};
+
+/// \brief Blocking client connection to the server, on the loopback interface.
+class client
+{
+public:
+    explicit client(uint16_t port) : fd_(::socket(AF_INET, SOCK_STREAM, 0))
+    {
+        // The segments are sent as they are written, to split a request as the test asks.
+        const int enable = 1;
+        ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        timeval timeout{5, 0};
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        connected_ = ::connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    ~client() { ::close(fd_); }
+
+    bool connected() const noexcept { return connected_; }
+
+    void send(const std::string& data)
+    {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            const ssize_t result = ::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (result <= 0)
+                return;
+            sent += static_cast<size_t>(result);
+        }
+    }
+
+    /// \brief Read the next response, its message body is delimited by its Content-Length.
+    ///
+    /// \param r Set to the response.
+    /// \param head True if the response answers a HEAD request, without any message body.
+    /// \returns False if the connection was closed or timed out first.
+    bool receive(response& r, bool head = false)
+    {
+        size_t header_end;
+        while ((header_end = input_.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill())
+                return false;
+        }
+
+        std::istringstream header(input_.substr(0, header_end));
+        std::string line;
+        std::getline(header, line);
+        r = response();
+        r.status = std::atoi(line.substr(line.find(' ') + 1).c_str());
+        while (std::getline(header, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            const size_t colon = line.find(':');
+            if (colon == std::string::npos)
+                continue;
+            std::string name = line.substr(0, colon);
+            for (auto& c : name)
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            r.header[name] = line.substr(line.find_first_not_of(' ', colon + 1));
+        }
+        input_.erase(0, header_end + 4);
+
+        const auto length_it = r.header.find("content-length");
+        const size_t length = (head || length_it == r.header.end()) ? 0 : std::stoul(length_it->second);
+        while (input_.size() < length) {
+            if (!fill())
+                return false;
+        }
+        r.body = input_.substr(0, length);
+        input_.erase(0, length);
+        return true;
+    }
+
+    /// \brief Check if the server closed the connection, once its responses are read.
+    bool closed()
+    {
+        return input_.empty() && !fill();
+    }
+
+private:
+    bool fill()
+    {
+        char buffer[16 * 1024];
+        const ssize_t received = ::recv(fd_, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+            return false;
+        input_.append(buffer, static_cast<size_t>(received));
+        return true;
+    }
+
+    int fd_;
+    bool connected_;
+    std::string input_;
+};
+
+uint16_t free_port()
+{
+    // The port is released right away, for the server to bind it.
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    ::close(fd);
+    return ntohs(address.sin_port);
+}
+
+bool uring_supported()
+{
+#ifdef HAVE_LIBURING
+    return http_uring_reactor::supported();
+#else
+    return false;
+#endif
+}
+
+std::string read_file(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+}
+
+/// \brief Server running a reactor engine on the website of the conformance tests, for the conformance
+///        requests replayed over a socket.
+class http_server_test : public ::testing::Test {
+protected:
+    virtual void TearDown() {
+        if (server_) {
+            server_->drain();
+            thread_.join();
+        }
+    }
+
+    void start(http_server_options::engine engine, const std::string& remote_workers_endpoint = "") {
+        http_server_options options;
+        options.front_end = engine;
+        if (!remote_workers_endpoint.empty()) {
+            options.dispatch_mode = http_server_options::dispatch::least_loaded;
+            options.remote_workers_endpoint = remote_workers_endpoint;
+            options.heartbeat_interval = std::chrono::milliseconds(100);
+        }
+        options.workers = 2;
+        // Small bodies already leave the receive buffer for a file, and the limit is quickly reached.
+        options.body_spill_threshold = 16;
+        options.max_request_body = 1024;
+        options.drain_timeout = std::chrono::seconds(5);
+
+        port_ = free_port();
+        host_ = "Host: localhost:" + std::to_string(port_) + "\r\n";
+        server_ = std::make_unique<http_server>(options);
+        server_->connect(WEBSITE, "localhost", port_, WEBSITE);
+        thread_ = std::thread([this]() { server_->run(); });
+    }
+
+    std::string get(const std::string& uri) const {
+        return "GET " + uri + " HTTP/1.1\r\n" + host_ + "\r\n";
+    }
+
+    uint16_t port_;
+    std::string host_;
+    std::unique_ptr<http_server> server_;
+    std::thread thread_;
+};
+
+class http_server_loopback_test : public http_server_test,
+                                  public ::testing::WithParamInterface<http_server_options::engine> {
+protected:
+    virtual void SetUp() {
+        if (GetParam() == http_server_options::engine::io_uring && !uring_supported())
+            GTEST_SKIP() << "io_uring is not available, see http_server_fallback_test.";
+        start(GetParam());
+    }
+};
+
+TEST_P (http_server_loopback_test, get_file_body) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    ///////////////////////////////////////////////////////
+    // The engine writes the message body left in the file by the worker.
+    c.send(get("/basic.html"));
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ(read_file(std::string(WEBSITE) + "/basic.html"), r.body);
+    EXPECT_EQ("keep-alive", r.header["connection"]);
+
+    // The connection persists for the next request.
+    c.send(get("/missing.html"));
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(404, r.status);
+}
+
+TEST_P (http_server_loopback_test, head) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    c.send(get("/basic.html"));
+    response get_response;
+    ASSERT_TRUE(c.receive(get_response));
+
+    c.send("HEAD /basic.html HTTP/1.1\r\n" + host_ + "\r\n");
+    response head_response;
+    ASSERT_TRUE(c.receive(head_response, true));
+    EXPECT_EQ(200, head_response.status);
+    EXPECT_EQ(get_response.header["content-length"], head_response.header["content-length"]);
+
+    // No message body precedes the next response.
+    c.send(get("/basic.html"));
+    response next;
+    ASSERT_TRUE(c.receive(next));
+    EXPECT_EQ(200, next.status);
+    EXPECT_EQ(get_response.body, next.body);
+}
+
+TEST_P (http_server_loopback_test, pipelined_requests) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    ///////////////////////////////////////////////////////
+    // The requests processed in parallel are answered in their order.
+    c.send(get("/basic.html") + get("/missing.html") + "HEAD /basic.html HTTP/1.1\r\n" + host_ + "\r\n" + get("/basic.html"));
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+    EXPECT_FALSE(r.body.empty());
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(404, r.status);
+    ASSERT_TRUE(c.receive(r, true));
+    EXPECT_EQ(200, r.status);
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+    EXPECT_FALSE(r.body.empty());
+}
+
+TEST_P (http_server_loopback_test, split_request) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    ///////////////////////////////////////////////////////
+    // Every segment is received on its own, the request is reassembled before it is dispatched.
+    const std::string request = get("/basic.html");
+    for (size_t begin = 0; begin < request.size(); begin += 7) {
+        c.send(request.substr(begin, 7));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+    EXPECT_FALSE(r.body.empty());
+}
+
+TEST_P (http_server_loopback_test, request_body) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    ///////////////////////////////////////////////////////
+    // The message body, spilled to a file past its threshold, is not mistaken for the next request.
+    const std::string body(64, 'a');
+    c.send("POST /basic.html HTTP/1.1\r\n" + host_ + "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" +
+           body.substr(0, 10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    c.send(body.substr(10) + get("/basic.html"));
+
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(405, r.status);
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ(read_file(std::string(WEBSITE) + "/basic.html"), r.body);
+}
+
+TEST_P (http_server_loopback_test, post_static_file) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    ///////////////////////////////////////////////////////
+    // The files are only read, the refusal announces the length of its own empty body and not the one of
+    // the file, for the connection to persist.
+    c.send("POST /basic.html HTTP/1.1\r\n" + host_ + "\r\n" + get("/basic.html"));
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(405, r.status);
+    EXPECT_EQ("GET, HEAD", r.header["allow"]);
+    EXPECT_EQ("0", r.header["content-length"]);
+    EXPECT_EQ("keep-alive", r.header["connection"]);
+
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ(read_file(std::string(WEBSITE) + "/basic.html"), r.body);
+}
+
+TEST_P (http_server_loopback_test, invalid_requests) {
+    {
+        client c(port_);
+        ASSERT_TRUE(c.connected());
+        c.send("POST /basic.html HTTP/1.1\r\n" + host_ + "Content-Length: 18446744073709551615\r\n\r\n" + get("/basic.html"));
+        response r;
+        ASSERT_TRUE(c.receive(r));
+        EXPECT_EQ(413, r.status);
+        EXPECT_TRUE(c.closed());
+    }
+    {
+        client c(port_);
+        ASSERT_TRUE(c.connected());
+        c.send(get("/basic.html").insert(4, std::string(http_request_framer::MAX_HEADER_LENGTH, 'a')));
+        response r;
+        ASSERT_TRUE(c.receive(r));
+        EXPECT_EQ(400, r.status);
+        EXPECT_TRUE(c.closed());
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(engines, http_server_loopback_test,
+                        ::testing::Values(http_server_options::engine::epoll, http_server_options::engine::io_uring));
+
+/// \brief Server asking for the io_uring engine where the ring cannot be created, served by epoll instead.
+class http_server_fallback_test : public http_server_test {
+protected:
+    virtual void SetUp() {
+        if (uring_supported())
+            GTEST_SKIP() << "io_uring is available, the engine does not fall back.";
+        start(http_server_options::engine::io_uring);
+    }
+};
+
+TEST_F (http_server_fallback_test, get_file_body) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    c.send(get("/basic.html"));
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ(read_file(std::string(WEBSITE) + "/basic.html"), r.body);
+}
+
+/// \brief Server accepting the workers of nodes running in the same process, over the loopback interface.
+class http_server_remote_test : public http_server_test {
+protected:
+    virtual void SetUp() {
+        endpoint_ = "tcp://127.0.0.1:" + std::to_string(free_port());
+        start(http_server_options::engine::epoll, endpoint_);
+    }
+
+    virtual void TearDown() {
+        for (auto& node : nodes_)
+            node->drain();
+        for (auto& thread : node_threads_)
+            thread.join();
+        http_server_test::TearDown();
+    }
+
+    void start_node() {
+        http_server_options options;
+        options.workers = 2;
+        options.heartbeat_interval = std::chrono::milliseconds(100);
+        nodes_.push_back(std::make_unique<http_worker_node>(endpoint_, options));
+        nodes_.back()->connect(WEBSITE, "localhost", port_, WEBSITE);
+        http_worker_node& node = *nodes_.back();
+        node_threads_.emplace_back([&node]() { node.run(); });
+    }
+
+    /// \brief Identifiers of the remote workers announced to the front-end.
+    std::vector<uint32_t> remote_workers() const {
+        std::vector<uint32_t> workers;
+        for (const auto& load : server_->queue_depths()) {
+            if (load.worker & http_dispatcher::REMOTE_WORKER)
+                workers.push_back(static_cast<uint32_t>(load.worker));
+        }
+        return workers;
+    }
+
+    std::string endpoint_;
+    std::vector<std::unique_ptr<http_worker_node>> nodes_;
+    std::vector<std::thread> node_threads_;
+};
+
+TEST_F (http_server_remote_test, node_identifiers) {
+    start_node();
+    start_node();
+
+    ///////////////////////////////////////////////////////
+    // Every worker of both nodes is announced: zmq would refuse those of a node taking the identifiers of the other.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (remote_workers().size() < 4 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const std::vector<uint32_t> workers = remote_workers();
+    ASSERT_EQ(4u, workers.size());
+
+    std::set<uint32_t> nodes;
+    for (const uint32_t worker : workers)
+        nodes.insert(worker & http_dispatcher::WORKER_NODE);
+    EXPECT_EQ(2u, nodes.size());
+
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+    c.send(get("/basic.html"));
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+}
+
+/// \brief Requests of the conformance tests of the library (method, framing and request view), replayed over a
+///        socket against every reactor engine instead of being handed to the service or the parsers directly.
+class http_server_conformance_test : public http_server_loopback_test {
+protected:
+    /// \brief Send a request and read its response on a new connection.
+    response exchange(const std::string& request, bool head = false) {
+        client c(port_);
+        response r;
+        EXPECT_TRUE(c.connected());
+        c.send(request);
+        EXPECT_TRUE(c.receive(r, head)) << request;
+        return r;
+    }
+
+    /// \brief Send a request the front-end refuses, the connection is closed after the refusal.
+    void expect_refused(const std::string& request, int status) {
+        client c(port_);
+        ASSERT_TRUE(c.connected());
+        c.send(request);
+        response r;
+        ASSERT_TRUE(c.receive(r)) << request;
+        EXPECT_EQ(status, r.status) << request;
+        EXPECT_TRUE(c.closed()) << request;
+    }
+};
+
+TEST_P (http_server_conformance_test, method_get) {
+    const response r = exchange(get("/basic.html"));
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ(read_file(std::string(WEBSITE) + "/basic.html"), r.body);
+    EXPECT_EQ(std::to_string(r.body.size()), r.header.at("content-length"));
+}
+
+TEST_P (http_server_conformance_test, method_get_query) {
+    const response r = exchange(get("/basic.html?version=2"));
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ(read_file(std::string(WEBSITE) + "/basic.html"), r.body);
+}
+
+TEST_P (http_server_conformance_test, method_head) {
+    response get_response = exchange(get("/basic.html"));
+    response head_response = exchange("HEAD /basic.html HTTP/1.1\r\n" + host_ + "\r\n", true);
+    EXPECT_EQ(200, head_response.status);
+
+    // The two responses may be dated from different seconds.
+    get_response.header.erase("date");
+    head_response.header.erase("date");
+    EXPECT_EQ(get_response.header, head_response.header) << "RFC2616 section 9.4: The metainformation contained in the HTTP headers in response to a HEAD request SHOULD be identical to the information sent in response to a GET request.";
+
+    // The connection is left without any message body, see http_server_loopback_test.head.
+}
+
+TEST_P (http_server_conformance_test, method_post) {
+    // No resource is created by a POST, a missing one is not found whatever the method.
+    EXPECT_EQ(404, exchange("POST /invalid.html HTTP/1.1\r\n" + host_ + "\r\n").status);
+
+    const response r = exchange("POST /basic.html HTTP/1.1\r\n" + host_ + "\r\n");
+    EXPECT_EQ(405, r.status);
+    EXPECT_EQ("GET, HEAD", r.header.at("allow"));
+    EXPECT_EQ("0", r.header.at("content-length"));
+}
+
+TEST_P (http_server_conformance_test, framing_split_header) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    // Every byte is a segment of its own.
+    const std::string request = get("/basic.html");
+    for (const char byte : request)
+        c.send(std::string(1, byte));
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+}
+
+TEST_P (http_server_conformance_test, framing_content_length_body) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    c.send("POST /form HTTP/1.1\r\n" + host_ + "content-length:  11 \r\n\r\nhello world" + get("/basic.html"));
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(404, r.status);
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+}
+
+TEST_P (http_server_conformance_test, framing_leading_empty_lines) {
+    const response r = exchange("\r\n\r\n" + get("/basic.html"));
+    EXPECT_EQ(200, r.status);
+}
+
+TEST_P (http_server_conformance_test, framing_invalid_header) {
+    expect_refused("POST /basic.html HTTP/1.1\r\n" + host_ + "Content-Length: 12a\r\n\r\n", 400);
+    expect_refused("POST /basic.html HTTP/1.1\r\n" + host_ + "Content-Length: 1\r\nContent-Length: 2\r\n\r\n", 400);
+    expect_refused("POST /basic.html HTTP/1.1\r\n" + host_ + "Transfer-Encoding: chunked\r\n\r\n", 400);
+    expect_refused("GET / HTTP/1.1\r\nX-Padding: " + std::string(http_request_framer::MAX_HEADER_LENGTH, 'a') + "\r\n\r\n", 400);
+}
+
+TEST_P (http_server_conformance_test, framing_too_large) {
+    expect_refused("POST /basic.html HTTP/1.1\r\n" + host_ + "Content-Length: 18446744073709551615\r\n\r\n", 413);
+    expect_refused("POST /basic.html HTTP/1.1\r\n" + host_ + "Content-Length: 1025\r\n\r\n", 413);
+}
+
+TEST_P (http_server_conformance_test, framing_pipelined_requests) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    // The last request is still incomplete, and left unanswered.
+    c.send("POST /a HTTP/1.1\r\n" + host_ + "Content-Length: 3\r\n\r\nabc" + get("/b") + "GET /c HTTP/1.1\r\n");
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(404, r.status);
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(404, r.status);
+}
+
+TEST_P (http_server_conformance_test, request_view_connection_close) {
+    client c(port_);
+    ASSERT_TRUE(c.connected());
+
+    c.send("GET /basic.html HTTP/1.1\r\n" + host_ + "Connection: Keep-Alive, Close\r\n\r\n");
+    response r;
+    ASSERT_TRUE(c.receive(r));
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ("close", r.header["connection"]);
+    EXPECT_TRUE(c.closed());
+}
+
+TEST_P (http_server_conformance_test, request_view_invalid_request_line) {
+    EXPECT_EQ(400, exchange("GET  /basic.html HTTP/1.1\r\n" + host_ + "\r\n").status);
+    EXPECT_EQ(400, exchange("FETCH /basic.html HTTP/1.1\r\n" + host_ + "\r\n").status);
+    EXPECT_EQ(400, exchange("GET /basic.html HTTP/2.0\r\n" + host_ + "\r\n").status);
+}
+
+TEST_P (http_server_conformance_test, request_view_request_uri) {
+    ///////////////////////////////////////////////////////
+    // The host of an absoluteURI takes precedence over the Host header (RFC2616 section 5.2).
+    const std::string authority = "localhost:" + std::to_string(port_);
+    response r = exchange("GET http://" + authority + "/basic.html?sort=name HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ(read_file(std::string(WEBSITE) + "/basic.html"), r.body);
+
+    r = exchange("GET http://example.com/basic.html HTTP/1.1\r\n" + host_ + "\r\n");
+    EXPECT_EQ(400, r.status);
+}
+
+INSTANTIATE_TEST_CASE_P(engines, http_server_conformance_test,
+                        ::testing::Values(http_server_options::engine::epoll, http_server_options::engine::io_uring));